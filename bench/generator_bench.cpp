@@ -0,0 +1,147 @@
+#include <numeric>
+#include <ranges>
+#include <vector>
+#include <asyncpp/generator.hpp>
+#include "harness.hpp"
+
+namespace async::bench
+{
+    namespace
+    {
+        constexpr std::size_t element_count = 1 << 16;
+
+        const std::vector<int> &values()
+        {
+            static const auto data = []
+            {
+                std::vector<int> result(element_count);
+                std::iota(result.begin(), result.end(), 0);
+                return result;
+            }();
+            return data;
+        }
+
+        generator<int> counter(int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                co_yield int(i);
+            }
+        }
+
+        bool is_even(int v) noexcept
+        {
+            return v % 2 == 0;
+        }
+
+        long long scale(int v) noexcept
+        {
+            return v * 3ll;
+        }
+
+        // Registers a benchmark that consumes element_count elements per iteration.
+        void add_per_element(std::string name, auto body)
+        {
+            add(std::move(name), [body](state &s)
+                {
+                    s.set_items_per_iteration(element_count);
+                    for (std::size_t i = 0; i < s.iterations(); ++i)
+                    {
+                        do_not_optimize(body());
+                    } });
+        }
+    }
+
+    void register_generator_benchmarks()
+    {
+        add_per_element("generator/baseline/raw_loop", []
+                        {
+                            long long sum = 0;
+                            for (auto v : values())
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/baseline/ranges_filter_transform", []
+                        {
+                            long long sum = 0;
+                            for (auto v : values() | std::views::filter(is_even) | std::views::transform(scale))
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/iterate/coroutine", []
+                        {
+                            long long sum = 0;
+                            for (auto v : counter(element_count))
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/iterate/contiguous", []
+                        {
+                            long long sum = 0;
+                            for (auto v : generator<int>(values()))
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/select", []
+                        { return counter(element_count).select(scale).count(); });
+
+        add_per_element("generator/where", []
+                        { return counter(element_count).where(is_even).count(); });
+
+        add_per_element("generator/where_select", []
+                        {
+                            long long sum = 0;
+                            for (auto v : counter(element_count).where(is_even).select(scale))
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/ranges_filter_transform", []
+                        {
+                            long long sum = 0;
+                            for (auto v : counter(element_count) | std::views::filter(is_even) | std::views::transform(scale))
+                            {
+                                sum += v;
+                                do_not_optimize(sum);
+                            }
+                            return sum; });
+
+        add_per_element("generator/take", []
+                        { return counter(element_count).take(element_count).count(); });
+
+        add_per_element("generator/distinct", []
+                        { return counter(element_count).distinct(element_count).count(); });
+
+        add_per_element("generator/sum/coroutine", []
+                        { return counter(element_count).sum(); });
+
+        add_per_element("generator/sum/contiguous", []
+                        { return generator<int>(values()).sum(); });
+
+        add_per_element("generator/window", []
+                        { return counter(element_count).window(16).count(); });
+
+        add_per_element("generator/rolling_max", []
+                        { return counter(element_count).rolling_max(16).count(); });
+
+        add_per_element("generator/zip", []
+                        { return zip(counter(element_count), counter(element_count)).count(); });
+
+        add_per_element("generator/to_vector", []
+                        { return counter(element_count).to_vector().size(); });
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace async::bench
+{
+    /**
+     * @brief Passed to every benchmark, which runs its body iterations() times.
+     *
+     * Benchmarks that process many elements per iteration report them through set_items_per_iteration
+     * so results are comparable as items per second.
+     */
+    class state
+    {
+    public:
+        explicit state(std::size_t iterations) noexcept
+            : _iterations(iterations)
+        {
+        }
+
+        std::size_t iterations() const noexcept
+        {
+            return _iterations;
+        }
+
+        void set_items_per_iteration(std::size_t items) noexcept
+        {
+            _items_per_iteration = items;
+        }
+
+        std::size_t items_per_iteration() const noexcept
+        {
+            return _items_per_iteration;
+        }
+
+    private:
+        std::size_t _iterations;
+        std::size_t _items_per_iteration = 1;
+    };
+
+    struct benchmark
+    {
+        std::string name;
+        std::function<void(state &)> body;
+    };
+
+    std::vector<benchmark> &registry();
+
+    inline void add(std::string name, std::function<void(state &)> body)
+    {
+        registry().push_back(benchmark{std::move(name), std::move(body)});
+    }
+
+    /**
+     * @brief Keeps the compiler from discarding a computed value.
+     */
+    template <typename T>
+    inline void do_not_optimize(const T &value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T *sink;
+        sink = &value;
+#endif
+    }
+
+    void register_generator_benchmarks();
+
+    void register_queue_benchmarks();
+
+    void register_task_benchmarks();
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "harness.hpp"
+
+namespace async::bench
+{
+    std::vector<benchmark> &registry()
+    {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    namespace
+    {
+        struct options
+        {
+            std::string filter;
+            std::string out;
+            double min_time = 0.25;
+            std::size_t repetitions = 3;
+        };
+
+        struct result
+        {
+            std::string name;
+            std::size_t iterations;
+            double ns_per_iteration;
+            double items_per_second;
+        };
+
+        double run_once(const benchmark &bench, std::size_t iterations, std::size_t &items)
+        {
+            state s(iterations);
+            auto start = std::chrono::steady_clock::now();
+            bench.body(s);
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            items = s.items_per_iteration();
+            return elapsed;
+        }
+
+        result run(const benchmark &bench, const options &opts)
+        {
+            // Grow the iteration count until one run takes at least min_time, then repeat and keep the median.
+            std::size_t iterations = 1;
+            std::size_t items = 1;
+            auto elapsed = run_once(bench, iterations, items);
+            while (elapsed < opts.min_time && iterations < (std::size_t(1) << 40))
+            {
+                auto factor = elapsed <= 0 ? 10.0 : std::clamp(opts.min_time * 1.4 / elapsed, 1.5, 10.0);
+                iterations = static_cast<std::size_t>(iterations * factor) + 1;
+                elapsed = run_once(bench, iterations, items);
+            }
+
+            std::vector<double> times{elapsed};
+            while (times.size() < opts.repetitions)
+            {
+                times.push_back(run_once(bench, iterations, items));
+            }
+            std::sort(times.begin(), times.end());
+            auto median = times[times.size() / 2];
+
+            return result{bench.name, iterations, median * 1e9 / iterations, static_cast<double>(items) * iterations / median};
+        }
+
+        std::string to_json(const std::vector<result> &results)
+        {
+            auto now = std::time(nullptr);
+            char date[32];
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+            std::ostringstream out;
+            out << std::setprecision(12);
+            out << "{\n  \"context\": {\n"
+                << "    \"date\": \"" << date << "\",\n"
+                << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#if defined(NDEBUG)
+                << "    \"library_build_type\": \"release\"\n"
+#else
+                << "    \"library_build_type\": \"debug\"\n"
+#endif
+                << "  },\n  \"benchmarks\": [";
+            for (std::size_t i = 0; i < results.size(); ++i)
+            {
+                const auto &r = results[i];
+                out << (i == 0 ? "\n" : ",\n")
+                    << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                    << ", \"real_time\": " << r.ns_per_iteration << ", \"time_unit\": \"ns\""
+                    << ", \"items_per_second\": " << r.items_per_second << "}";
+            }
+            out << "\n  ]\n}\n";
+            return out.str();
+        }
+
+        bool parse(int argc, char **argv, options &opts)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                std::string arg = argv[i];
+                auto value = [&](const char *prefix) -> const char *
+                {
+                    auto length = std::char_traits<char>::length(prefix);
+                    return arg.compare(0, length, prefix) == 0 ? argv[i] + length : nullptr;
+                };
+
+                if (auto v = value("--filter="))
+                {
+                    opts.filter = v;
+                }
+                else if (auto v = value("--out="))
+                {
+                    opts.out = v;
+                }
+                else if (auto v = value("--min-time="))
+                {
+                    opts.min_time = std::stod(v);
+                }
+                else if (auto v = value("--repetitions="))
+                {
+                    opts.repetitions = std::max<std::size_t>(std::stoul(v), 1);
+                }
+                else
+                {
+                    std::cerr << "usage: " << argv[0] << " [--filter=<substring>] [--out=<file.json>] [--min-time=<seconds>] [--repetitions=<n>]\n";
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    using namespace async::bench;
+
+    options opts;
+    if (!parse(argc, argv, opts))
+    {
+        return 2;
+    }
+
+    register_generator_benchmarks();
+    register_queue_benchmarks();
+    register_task_benchmarks();
+
+    // Results go to stderr as they come in, the JSON report to stdout or --out.
+    std::vector<result> results;
+    for (const auto &bench : registry())
+    {
+        if (bench.name.find(opts.filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        auto r = run(bench, opts);
+        std::fprintf(stderr, "%-48s %14.1f ns %16.0f items/s\n", r.name.c_str(), r.ns_per_iteration, r.items_per_second);
+        results.push_back(std::move(r));
+    }
+
+    auto json = to_json(results);
+    if (opts.out.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream(opts.out) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <asyncpp/bounded_queue.hpp>
+#include <asyncpp/queue.hpp>
+#include "harness.hpp"
+
+namespace async::bench
+{
+    namespace
+    {
+        constexpr std::size_t item_count = 1 << 16;
+
+        constexpr std::size_t bounded_capacity = 1024;
+
+        template <typename Producers = producers::multi, typename Consumers = consumers::multi>
+        struct unbounded_adapter
+        {
+            queue<int, 1024, Producers, Consumers> q;
+
+            bool try_push(int v)
+            {
+                q.push(v);
+                return true;
+            }
+
+            std::optional<int> try_pop()
+            {
+                return q.try_pop();
+            }
+
+            const int *push_batch(const int *first, const int *last)
+            {
+                q.push_range(first, last);
+                return last;
+            }
+
+            std::size_t pop_batch(int *out, std::size_t max)
+            {
+                return q.try_pop_bulk(out, max);
+            }
+        };
+
+        template <std::size_t Capacity = 0>
+        struct bounded_adapter
+        {
+            std::conditional_t<Capacity == 0, bounded_queue<int>, bounded_queue<int, Capacity>> q = _make();
+
+            bool try_push(int v)
+            {
+                return q.try_push(v);
+            }
+
+            std::optional<int> try_pop()
+            {
+                return q.try_pop();
+            }
+
+            const int *push_batch(const int *first, const int *last)
+            {
+                return q.push_range(first, last);
+            }
+
+            std::size_t pop_batch(int *out, std::size_t max)
+            {
+                return q.try_pop_bulk(out, max);
+            }
+
+        private:
+            static auto _make()
+            {
+                if constexpr (Capacity == 0)
+                {
+                    return bounded_queue<int>(bounded_capacity);
+                }
+                else
+                {
+                    return bounded_queue<int, Capacity>();
+                }
+            }
+        };
+
+        // Moves item_count items from the producers to the consumers, consumers stop once every producer
+        // finished and the queue reads empty. A Batch above one goes through the bulk operations.
+        template <typename Adapter, std::size_t Batch>
+        void transfer(std::size_t producers, std::size_t consumers)
+        {
+            Adapter adapter;
+            std::atomic<std::size_t> producing = producers;
+            std::vector<std::thread> threads;
+            threads.reserve(producers + consumers);
+
+            for (std::size_t p = 0; p < producers; ++p)
+            {
+                threads.emplace_back([&, p]
+                                     {
+                                         const auto begin = item_count * p / producers;
+                                         const auto end = item_count * (p + 1) / producers;
+                                         if constexpr (Batch > 1)
+                                         {
+                                             int batch[Batch];
+                                             for (auto i = begin; i < end; i += Batch)
+                                             {
+                                                 const auto count = std::min(Batch, end - i);
+                                                 std::iota(batch, batch + count, static_cast<int>(i));
+                                                 const int *first = batch;
+                                                 while ((first = adapter.push_batch(first, batch + count)) != batch + count)
+                                                 {
+                                                     std::this_thread::yield();
+                                                 }
+                                             }
+                                         }
+                                         else
+                                         {
+                                             for (auto i = begin; i < end; ++i)
+                                             {
+                                                 while (!adapter.try_push(static_cast<int>(i)))
+                                                 {
+                                                     std::this_thread::yield();
+                                                 }
+                                             }
+                                         }
+                                         producing.fetch_sub(1, std::memory_order_release); });
+            }
+
+            for (std::size_t c = 0; c < consumers; ++c)
+            {
+                threads.emplace_back([&]
+                                     {
+                                         long long sum = 0;
+                                         if constexpr (Batch > 1)
+                                         {
+                                             int batch[Batch];
+                                             while (true)
+                                             {
+                                                 auto count = adapter.pop_batch(batch, Batch);
+                                                 if (count == 0)
+                                                 {
+                                                     if (producing.load(std::memory_order_acquire) == 0)
+                                                     {
+                                                         count = adapter.pop_batch(batch, Batch);
+                                                         if (count == 0)
+                                                         {
+                                                             break;
+                                                         }
+                                                     }
+                                                     else
+                                                     {
+                                                         // Leave the core to the producers instead of spinning out the time slice.
+                                                         std::this_thread::yield();
+                                                     }
+                                                 }
+                                                 sum = std::accumulate(batch, batch + count, sum);
+                                             }
+                                             do_not_optimize(sum);
+                                             return;
+                                         }
+
+                                         while (true)
+                                         {
+                                             if (auto v = adapter.try_pop())
+                                             {
+                                                 sum += *v;
+                                             }
+                                             else if (producing.load(std::memory_order_acquire) == 0)
+                                             {
+                                                 if (auto last = adapter.try_pop())
+                                                 {
+                                                     sum += *last;
+                                                     continue;
+                                                 }
+                                                 break;
+                                             }
+                                             else
+                                             {
+                                                 std::this_thread::yield();
+                                             }
+                                         }
+                                         do_not_optimize(sum); });
+            }
+
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+        }
+
+        using shape = std::pair<std::size_t, std::size_t>;
+
+        template <typename Adapter, std::size_t Batch = 1>
+        void add_throughput(const std::string &name, std::initializer_list<shape> shapes = {{1, 1}, {2, 2}, {4, 4}, {4, 1}, {1, 4}})
+        {
+            for (auto [producers, consumers] : shapes)
+            {
+                add(name + "/producers:" + std::to_string(producers) + "/consumers:" + std::to_string(consumers),
+                    [producers, consumers](state &s)
+                    {
+                        s.set_items_per_iteration(item_count);
+                        for (std::size_t i = 0; i < s.iterations(); ++i)
+                        {
+                            transfer<Adapter, Batch>(producers, consumers);
+                        }
+                    });
+            }
+        }
+    }
+
+    void register_queue_benchmarks()
+    {
+        add_throughput<unbounded_adapter<>>("queue");
+        add_throughput<unbounded_adapter<producers::single, consumers::single>>("queue<spsc>", {{1, 1}});
+        add_throughput<unbounded_adapter<producers::multi, consumers::single>>("queue<mpsc>", {{1, 1}, {4, 1}});
+        add_throughput<unbounded_adapter<producers::single, consumers::multi>>("queue<spmc>", {{1, 1}, {1, 4}});
+        add_throughput<unbounded_adapter<>, 64>("queue/bulk:64", {{1, 1}, {4, 4}});
+        add_throughput<bounded_adapter<>>("bounded_queue");
+        add_throughput<bounded_adapter<bounded_capacity>>("bounded_queue<1024>");
+        add_throughput<bounded_adapter<>, 64>("bounded_queue/bulk:64", {{1, 1}, {4, 4}});
+    }
+}
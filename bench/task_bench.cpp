@@ -0,0 +1,39 @@
+#include <string>
+#include <vector>
+#include <asyncpp/task.hpp>
+#include "harness.hpp"
+
+namespace async::bench
+{
+    void register_task_benchmarks()
+    {
+        add("task/spawn_await", [](state &s)
+            {
+                for (std::size_t i = 0; i < s.iterations(); ++i)
+                {
+                    auto t = []() -> task<int>
+                    {
+                        co_return 1;
+                    }();
+                    do_not_optimize(t.get_result());
+                } });
+
+        for (std::size_t fan_out : {1, 8, 64})
+        {
+            add("task/when_all/" + std::to_string(fan_out), [fan_out](state &s)
+                {
+                    s.set_items_per_iteration(fan_out);
+                    for (std::size_t i = 0; i < s.iterations(); ++i)
+                    {
+                        std::vector<task<void>> tasks;
+                        tasks.reserve(fan_out);
+                        for (std::size_t j = 0; j < fan_out; ++j)
+                        {
+                            tasks.push_back([]() -> task<void>
+                                            { co_return; }());
+                        }
+                        task<void>::when_all(tasks).wait();
+                    } });
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
+#include <exception>
 #include <stdexcept>
+#include <vector>
 
 namespace async
 {
@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include "cache_line.hpp"
+#include "resume_deferral.hpp"
+
+namespace async
+{
+    /**
+     * @brief How much a queue may hold before producers are held back, unlimited by default.
+     *
+     * Once the depth reaches high_water, pushes fail, block or suspend until consumers brought it down to
+     * low_water, so a stalled consumer turns into backpressure instead of unbounded growth. A byte budget
+     * counts the storage of the elements themselves, not memory they own elsewhere.
+     */
+    struct queue_budget
+    {
+        enum class unit
+        {
+            elements,
+            bytes
+        };
+
+        std::size_t high_water = std::numeric_limits<std::size_t>::max();
+        std::size_t low_water = std::numeric_limits<std::size_t>::max();
+        unit measure = unit::elements;
+
+        static constexpr queue_budget elements(std::size_t high_water, std::size_t low_water) noexcept
+        {
+            return queue_budget{high_water, low_water, unit::elements};
+        }
+
+        static constexpr queue_budget bytes(std::size_t high_water, std::size_t low_water) noexcept
+        {
+            return queue_budget{high_water, low_water, unit::bytes};
+        }
+    };
+
+    namespace detail
+    {
+        using admission_waiter = deferred_waiter;
+
+        /**
+         * @brief Counts the elements of a budgeted queue and holds producers back between the water marks.
+         *
+         * Producers add to the depth before pushing, consumers subtract after popping. Reaching the high water
+         * mark closes admission, dropping to the low water mark opens it again and wakes every waiting producer.
+         */
+        class admission
+        {
+        public:
+            admission() = default;
+
+            admission(std::size_t high_water, std::size_t low_water) noexcept
+                : _high_water(std::max<std::size_t>(high_water, 1)), _low_water(std::min(low_water, _high_water - 1))
+            {
+            }
+
+            bool limited() const noexcept
+            {
+                return _high_water != std::numeric_limits<std::size_t>::max();
+            }
+
+            /**
+             * @brief Admits count elements unless admission is closed.
+             */
+            bool try_acquire(std::size_t count) noexcept
+            {
+                if (_closed.load(std::memory_order_seq_cst))
+                {
+                    return false;
+                }
+
+                admit(count);
+                return true;
+            }
+
+            /**
+             * @brief Admits count elements, parking the calling thread while admission is closed.
+             */
+            void acquire(std::size_t count) noexcept
+            {
+                while (!try_acquire(count))
+                {
+                    const auto epoch = _epoch.load(std::memory_order_acquire);
+                    _waiters.fetch_add(1, std::memory_order_seq_cst);
+                    if (_closed.load(std::memory_order_seq_cst))
+                    {
+                        _epoch.wait(epoch, std::memory_order_acquire);
+                    }
+                    _waiters.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * @brief Admits count elements even if admission is closed, closing it once the high water mark is reached.
+             */
+            void admit(std::size_t count) noexcept
+            {
+                const auto depth = _depth.fetch_add(count, std::memory_order_seq_cst) + count;
+                if (depth >= _high_water && !_closed.exchange(true, std::memory_order_seq_cst))
+                {
+                    // Consumers may have drained past the low water mark before they could see admission closed.
+                    if (_depth.load(std::memory_order_seq_cst) <= _low_water)
+                    {
+                        _open();
+                    }
+                }
+            }
+
+            void release(std::size_t count) noexcept
+            {
+                const auto depth = _depth.fetch_sub(count, std::memory_order_seq_cst) - count;
+                if (depth <= _low_water && _closed.load(std::memory_order_seq_cst))
+                {
+                    _open();
+                }
+            }
+
+            /**
+             * @brief Queues waiter while admission is closed, false if it opened meanwhile.
+             */
+            bool park(admission_waiter &waiter) noexcept
+            {
+                std::lock_guard lock(_mutex);
+                _waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (!_closed.load(std::memory_order_seq_cst))
+                {
+                    _waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                if (_back != nullptr)
+                {
+                    _back->next = &waiter;
+                }
+                else
+                {
+                    _front = &waiter;
+                }
+                _back = &waiter;
+                return true;
+            }
+
+        private:
+            std::size_t _high_water = std::numeric_limits<std::size_t>::max();
+            std::size_t _low_water = std::numeric_limits<std::size_t>::max();
+            alignas(cache_line_size) std::atomic<std::size_t> _depth = 0;
+            std::atomic<bool> _closed = false;
+            std::atomic<std::size_t> _waiters = 0;
+            std::atomic<std::uint32_t> _epoch = 0;
+            std::mutex _mutex;
+            admission_waiter *_front = nullptr;
+            admission_waiter *_back = nullptr;
+
+            void _open() noexcept
+            {
+                if (!_closed.exchange(false, std::memory_order_seq_cst) || _waiters.load(std::memory_order_seq_cst) == 0)
+                {
+                    return;
+                }
+
+                _epoch.fetch_add(1, std::memory_order_release);
+                _epoch.notify_all();
+
+                admission_waiter *front;
+                {
+                    std::lock_guard lock(_mutex);
+                    front = std::exchange(_front, nullptr);
+                    _back = nullptr;
+                }
+
+                // Suspended producers resume on the thread that opened admission, after the lock is released. Pops
+                // running under the queue's waiter lock defer them until that lock is released too.
+                while (front != nullptr)
+                {
+                    auto waiter = std::exchange(front, front->next);
+                    _waiters.fetch_sub(1, std::memory_order_relaxed);
+                    resume_deferral::resume(*waiter);
+                }
+            }
+        };
+    }
+}
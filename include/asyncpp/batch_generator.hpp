@@ -0,0 +1,246 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "generator.hpp"
+#include "simd.hpp"
+
+namespace async
+{
+    /**
+     * @brief A generator that yields contiguous blocks of elements instead of single elements.
+     *
+     * Coroutines may return a batch_generator<T> directly and co_yield std::span<const T> blocks,
+     * or one can be obtained from any generator<T> through generator<T>::batch.
+     * A yielded block is only valid until the generator is resumed.
+     */
+    template <typename T>
+    class batch_generator : public std::ranges::view_base
+    {
+    public:
+        using block_type = std::span<const T>;
+
+        using promise_type = typename generator<block_type>::promise_type;
+
+        using iterator = typename generator<block_type>::iterator;
+
+        batch_generator() = default;
+
+        batch_generator(generator<block_type> &&blocks) noexcept
+            : _blocks(std::move(blocks))
+        {
+        }
+
+        batch_generator(batch_generator &&other) noexcept = default;
+
+        batch_generator &operator=(batch_generator &&other) noexcept = default;
+
+        iterator begin() const
+        {
+            return _blocks.begin();
+        }
+
+        std::default_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+
+        bool all(std::invocable<const T &> auto &&pred) const
+        {
+            for (auto block : _blocks)
+            {
+                if (!std::all_of(block.begin(), block.end(), pred))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool any(std::invocable<const T &> auto &&pred) const
+        {
+            for (auto block : _blocks)
+            {
+                if (std::any_of(block.begin(), block.end(), pred))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        double average(summation mode = summation::pairwise) const
+        {
+            auto [sum, count] = _accumulate(mode);
+            return static_cast<double>(sum) / count;
+        }
+
+        std::size_t count() const
+        {
+            std::size_t result = 0;
+            for (auto block : _blocks)
+            {
+                result += block.size();
+            }
+            return result;
+        }
+
+        std::size_t count_if(std::predicate<const T &> auto &&pred) const
+        {
+            std::size_t result = 0;
+            for (auto block : _blocks)
+            {
+                result += simd::count_if(block, pred);
+            }
+            return result;
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        T max() const
+        {
+            return min_max().second;
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        T min() const
+        {
+            return min_max().first;
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        std::pair<T, T> min_max() const
+        {
+            std::optional<std::pair<T, T>> result;
+            for (auto block : _blocks)
+            {
+                if (block.empty())
+                {
+                    continue;
+                }
+
+                auto [lo, hi] = simd::min_max(block);
+                if (!result)
+                {
+                    result.emplace(lo, hi);
+                }
+                else
+                {
+                    result->first = std::min(result->first, lo);
+                    result->second = std::max(result->second, hi);
+                }
+            }
+
+            if (!result)
+            {
+                throw std::out_of_range("min_max");
+            }
+            return *result;
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        sum_t<T> sum(summation mode = summation::pairwise) const
+        {
+            return _accumulate(mode).first;
+        }
+
+        void for_each(std::invocable<block_type> auto &&func) const
+        {
+            for (auto block : _blocks)
+            {
+                func(block);
+            }
+        }
+
+        generator<T> unbatch()
+        {
+            return [](batch_generator<T> blocks_) -> generator<T>
+            {
+                for (auto block : blocks_)
+                {
+                    for (const auto &v : block)
+                    {
+                        co_yield v;
+                    }
+                }
+            }(std::move(*this));
+        }
+
+        std::vector<T> to_vector() const
+        {
+            std::vector<T> result;
+            for (auto block : _blocks)
+            {
+                result.insert(result.end(), block.begin(), block.end());
+            }
+            return result;
+        }
+
+    private:
+        generator<block_type> _blocks;
+
+        std::pair<sum_t<T>, std::size_t> _accumulate(summation mode) const
+        {
+            sum_t<T> sum = 0;
+            sum_t<T> compensation = 0;
+            // Pairwise block sums are combined like a binary counter, partials[i] holds the sum of 2^i blocks,
+            // so the cascade stays pairwise across blocks instead of only within each of them.
+            std::array<sum_t<T>, 64> partials{};
+            std::uint64_t blocks = 0;
+            std::size_t count = 0;
+            for (auto block : _blocks)
+            {
+                auto block_sum = simd::sum(block, mode);
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    if (mode == summation::kahan)
+                    {
+                        simd::detail::kahan_add(sum, compensation, block_sum);
+                    }
+                    else if (mode == summation::pairwise)
+                    {
+                        std::size_t level = 0;
+                        for (; blocks & (std::uint64_t(1) << level); ++level)
+                        {
+                            block_sum = partials[level] + block_sum;
+                        }
+                        partials[level] = block_sum;
+                        ++blocks;
+                    }
+                    else
+                    {
+                        sum += block_sum;
+                    }
+                }
+                else
+                {
+                    sum = simd::checked_add(sum, block_sum);
+                }
+                count += block.size();
+            }
+
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                for (std::size_t level = 0; level < partials.size(); ++level)
+                {
+                    if (blocks & (std::uint64_t(1) << level))
+                    {
+                        sum += partials[level];
+                    }
+                }
+            }
+            return {sum - compensation, count};
+        }
+    };
+}
@@ -1,83 +1,416 @@
 #pragma once
 #include <optional>
 #include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include <vector>
 #include "queue_exceptions.hpp"
+#include "sequenced_slot.hpp"
 
 namespace async
 {
     /**
      * @brief A fixed size lock-free queue implementation.
+     *
+     * Every slot carries a sequence number: a producer may write slot i of lap n once the sequence reads
+     * n * capacity + i and publishes it by bumping the sequence, consumers wait for that value and release the
+     * slot for the next lap the same way. Readers therefore never see a slot before its element is written and
+     * producers never overwrite one before it was moved out.
+     *
+     * A non-zero Capacity fixes the capacity at compile time and stores the slots inline, the slot index is then
+     * computed against a constant, a mask for powers of two. With Capacity 0 it is chosen at construction and
+     * power of two capacities are masked as well.
+     *
+     * The capacity has to be at least 2: with a single slot the sequence a producer publishes equals the one
+     * that frees the slot for the next lap, so a full queue could not be told apart from an empty one.
      */
-    template <typename T, std::size_t NodeCapacity>
+    template <typename T, std::size_t Capacity = 0>
     class bounded_queue
     {
+        static_assert(Capacity != 1, "bounded_queue needs a capacity of at least 2");
+
+        using slot_type = detail::sequenced_slot<T>;
+
     public:
-        bounded_queue(std::size_t capacity) : _data(new T[capacity]), _node_capacity(capacity), _head(0), _tail(0) {}
+        bounded_queue()
+            requires(Capacity != 0)
+            : _head(0), _tail(0)
+        {
+            _init_sequences();
+        }
 
-        template <typename T>
-        void bounded_queue<T>::push(const T &item)
+        /**
+         * @brief Allocates capacity slots, throws std::invalid_argument if capacity is less than 2.
+         */
+        bounded_queue(std::size_t capacity)
+            requires(Capacity == 0)
+            : _slots(std::make_unique<slot_type[]>(_checked_capacity(capacity))), _capacity(capacity),
+              _mask((capacity & (capacity - 1)) == 0 ? capacity - 1 : 0), _masked((capacity & (capacity - 1)) == 0), _head(0), _tail(0)
         {
-            auto tail = _tail.load();
+            _init_sequences();
+        }
 
-            // full
-            if ((tail + 1) % _node_capacity == _head.load())
-                throw queue_full_exception();
+        bounded_queue(const bounded_queue &) = delete;
+
+        bounded_queue &operator=(const bounded_queue &) = delete;
 
-            // retry if we couldn't update the tail in time.
-            if (!_tail.compare_exchange_strong(tail, (tail + 1) % _node_capacity))
-                return push(item);
+        std::size_t capacity() const noexcept
+        {
+            if constexpr (Capacity != 0)
+            {
+                return Capacity;
+            }
+            else
+            {
+                return _capacity;
+            }
+        }
 
-            _data[tail] = item;
+        void push(const T &item)
+        {
+            if (!try_emplace(item))
+            {
+                throw queue_full_exception();
+            }
         }
 
         void push(T &&item)
         {
-            auto tail = _tail.load();
-
-            // full
-            if ((tail + 1) % _node_capacity == _head.load())
+            if (!try_emplace(std::move(item)))
+            {
                 throw queue_full_exception();
+            }
+        }
 
-            // retry if we couldn't update the tail in time.
-            if (!_tail.compare_exchange_strong(tail, (tail + 1) % _node_capacity))
-                return push(item);
+        /**
+         * @brief Pushes item unless the queue is full, item is left untouched when it returns false.
+         *
+         * Only for element types whose move may throw can a failed push of an rvalue have moved from item,
+         * when another producer filled the last free slot between the check and the claim.
+         */
+        bool try_push(const T &item)
+        {
+            return try_emplace(item);
+        }
 
-            _data[tail] = std::move(item);
+        bool try_push(T &&item)
+        {
+            return try_emplace(std::move(item));
         }
 
-        T pop()
+        /**
+         * @brief Constructs an element from args in the next free slot, false if the queue is full.
+         *
+         * Throwing constructors run before a slot is claimed, a claimed slot always has to be published. They
+         * only run once a free slot was seen, so args are not consumed by a push into a queue that is already full.
+         */
+        template <typename... Args>
+        bool try_emplace(Args &&...args)
         {
-            auto head = _head.load();
+            if constexpr (std::is_nothrow_constructible_v<T, Args...>)
+            {
+                // Constructs straight into the slot, args are only used by a push that claimed one.
+                return _try_emplace(std::forward<Args>(args)...);
+            }
+            else
+            {
+                if (_full())
+                {
+                    return false;
+                }
+
+                T item(std::forward<Args>(args)...);
+                return _try_emplace(std::move(item));
+            }
+        }
+
+        /**
+         * @brief Moves the front element out, nullopt if the queue is empty.
+         */
+        std::optional<T> try_pop()
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &slot = _slot(head);
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - (head + 1));
+                if (diff == 0)
+                {
+                    if (_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                    {
+                        std::optional<T> item(slot.take());
+                        slot.sequence.store(head + capacity(), std::memory_order_release);
+                        return item;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // empty
+                    return std::nullopt;
+                }
+                else
+                {
+                    // another consumer took this slot, catch up.
+                    head = _head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Pushes as much of [first, last) as fits, reserving all of its slots with a single CAS.
+         *
+         * Elements whose construction may throw are copied into temporaries before any slot is claimed,
+         * a claimed slot always has to be published.
+         *
+         * @return An iterator to the first element that was not pushed, last if all of them were.
+         */
+        template <std::forward_iterator It, std::sentinel_for<It> Sentinel>
+            requires std::is_nothrow_constructible_v<T, std::iter_reference_t<It>> || std::is_nothrow_move_constructible_v<T>
+        It push_range(It first, Sentinel last)
+        {
+            if constexpr (std::is_nothrow_constructible_v<T, std::iter_reference_t<It>>)
+            {
+                _push_range(first, static_cast<std::size_t>(std::ranges::distance(first, last)));
+                return first;
+            }
+            else
+            {
+                std::vector<T> items;
+                for (auto it = first; it != last; ++it)
+                {
+                    items.emplace_back(*it);
+                }
+
+                auto moved = std::make_move_iterator(items.begin());
+                return std::ranges::next(first, _push_range(moved, items.size()));
+            }
+        }
 
-            // empty
-            if (head == _tail.load())
-                throw queue_empty_exception();
+        /**
+         * @brief Moves the published elements at the front, at most max of them, to out with a single CAS.
+         *
+         * If writing to out throws, the elements already written stay there, the rest of the claimed slots are
+         * destroyed and handed back to producers, and the exception propagates.
+         *
+         * @return The number of elements written to out.
+         */
+        template <std::output_iterator<T &&> OutputIt>
+        std::size_t try_pop_bulk(OutputIt out, std::size_t max)
+        {
+            auto head = _head.load(std::memory_order_relaxed);
+            std::size_t count;
+            do
+            {
+                count = 0;
+                while (count < max && count < capacity() &&
+                       _slot(head + count).sequence.load(std::memory_order_acquire) == head + count + 1)
+                {
+                    ++count;
+                }
+
+                if (count == 0)
+                {
+                    return 0;
+                }
+            } while (!_head.compare_exchange_weak(head, head + count, std::memory_order_relaxed));
 
-            // retry if we couldn't update the head in time.
-            if (!_head.compare_exchange_strong(head, (head + 1) % _node_capacity))
-                return pop();
+            // Every claimed slot has to be released, even when out throws, or producers would wait on it forever.
+            auto pos = head;
+            try
+            {
+                for (; pos != head + count; ++pos)
+                {
+                    auto &slot = _slot(pos);
+                    auto item = slot.take();
+                    slot.sequence.store(pos + capacity(), std::memory_order_release);
+                    *out = std::move(item);
+                    ++out;
+                }
+            }
+            catch (...)
+            {
+                for (; pos != head + count; ++pos)
+                {
+                    auto &slot = _slot(pos);
+                    if (slot.sequence.load(std::memory_order_relaxed) == pos + 1)
+                    {
+                        slot.destroy();
+                        slot.sequence.store(pos + capacity(), std::memory_order_release);
+                    }
+                }
+                throw;
+            }
+            return count;
+        }
 
-            auto item = _data[head];
-            return item;
+        /**
+         * @brief Moves the front element out, throws queue_empty_exception if the queue is empty.
+         */
+        T pop()
+        {
+            if (auto item = try_pop())
+            {
+                return std::move(*item);
+            }
+            throw queue_empty_exception();
         }
 
         std::size_t size() const
         {
-            auto tail = _tail.load();
             auto head = _head.load();
+            auto tail = _tail.load();
+            return tail > head ? tail - head : 0;
+        }
 
-            if (head > tail)
-                return head - tail;
-            else if (head == tail)
-                return 0;
-            else
-                return (tail - head);
+        ~bounded_queue()
+        {
+            for (auto i = _head.load(); i != _tail.load(); ++i)
+            {
+                _slot(i).destroy();
+            }
         }
 
     private:
-        T *_data;
-        std::size_t _node_capacity;
+        std::conditional_t<Capacity == 0, std::unique_ptr<slot_type[]>, slot_type[Capacity == 0 ? 1 : Capacity]> _slots;
+        [[no_unique_address]] std::conditional_t<Capacity == 0, std::size_t, std::monostate> _capacity{};
+        std::size_t _mask = 0;
+        bool _masked = false;
         std::atomic<std::size_t> _head;
         std::atomic<std::size_t> _tail;
+
+        static std::size_t _checked_capacity(std::size_t capacity)
+        {
+            if (capacity < 2)
+            {
+                throw std::invalid_argument("bounded_queue needs a capacity of at least 2");
+            }
+            return capacity;
+        }
+
+        void _init_sequences() noexcept
+        {
+            for (std::size_t i = 0; i < capacity(); ++i)
+            {
+                _slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        slot_type &_slot(std::size_t pos) noexcept
+        {
+            if constexpr (Capacity != 0)
+            {
+                return _slots[pos % Capacity];
+            }
+            else
+            {
+                return _slots[_masked ? pos & _mask : pos % _capacity];
+            }
+        }
+
+        /**
+         * @brief Constructs up to wanted elements from first in slots claimed with a single CAS, advancing first.
+         *
+         * @return The number of elements pushed.
+         */
+        template <typename It>
+        std::size_t _push_range(It &first, std::size_t wanted) noexcept
+        {
+            auto tail = _tail.load(std::memory_order_relaxed);
+            std::size_t count;
+            while (true)
+            {
+                // Slots up to head + capacity were claimed by consumers, at worst they are still moving out.
+                const auto head = _head.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(tail - head) < 0)
+                {
+                    // Consumers passed the tail read before the head, catch up.
+                    tail = _tail.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                const auto used = tail - head;
+                count = std::min(wanted, used < capacity() ? capacity() - used : 0);
+                if (count == 0)
+                {
+                    return 0;
+                }
+
+                if (_tail.compare_exchange_weak(tail, tail + count, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            for (auto pos = tail; pos != tail + count; ++pos, ++first)
+            {
+                auto &slot = _slot(pos);
+                while (slot.sequence.load(std::memory_order_acquire) != pos)
+                {
+                    std::this_thread::yield();
+                }
+                slot.construct(*first);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+            }
+            return count;
+        }
+
+        /**
+         * @brief Whether the next slot a producer would claim is still taken, a hint that can be stale right away.
+         */
+        bool _full() noexcept
+        {
+            auto tail = _tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                const auto diff = static_cast<std::ptrdiff_t>(_slot(tail).sequence.load(std::memory_order_acquire) - tail);
+                if (diff == 0)
+                {
+                    return false;
+                }
+                if (diff < 0)
+                {
+                    return true;
+                }
+                tail = _tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        template <typename... Args>
+        bool _try_emplace(Args &&...args)
+        {
+            auto tail = _tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &slot = _slot(tail);
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::ptrdiff_t>(sequence - tail);
+                if (diff == 0)
+                {
+                    if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                    {
+                        slot.construct(std::forward<Args>(args)...);
+                        slot.sequence.store(tail + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // full
+                    return false;
+                }
+                else
+                {
+                    // another producer took this slot, catch up.
+                    tail = _tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,273 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "cache_line.hpp"
+
+namespace async
+{
+    /**
+     * @brief A fixed size single producer ring whose every element is seen by every subscribed consumer.
+     *
+     * Each consumer owns a cursor, the sequence of the next element it reads. The producer may only overwrite a
+     * slot once the slowest cursor moved past it, and consumers read every element published since their last read
+     * in one batch, then advance their cursor once. Elements are read in place, never copied per consumer.
+     * Consumers only see elements published after they subscribed. Closing wakes every side, push fails from then
+     * on and consumers drain what is left.
+     */
+    template <typename T>
+    class broadcast_ring
+    {
+        struct cursor
+        {
+            alignas(cache_line_size) std::atomic<std::size_t> sequence = 0;
+        };
+
+    public:
+        /**
+         * @brief A subscription to the ring, unsubscribes when destroyed.
+         */
+        class consumer
+        {
+        public:
+            consumer(consumer &&) noexcept = default;
+
+            consumer &operator=(consumer &&) = delete;
+
+            /**
+             * @brief Calls handler with every available element, at most max of them, without waiting.
+             *
+             * @return The number of elements handed to handler.
+             */
+            template <std::invocable<const T &> Handler>
+            std::size_t poll(Handler &&handler, std::size_t max = std::numeric_limits<std::size_t>::max())
+            {
+                const auto begin = _cursor->sequence.load(std::memory_order_relaxed);
+                const auto count = std::min(_ring->_published.load(std::memory_order_acquire) - begin, max);
+                for (auto sequence = begin; sequence != begin + count; ++sequence)
+                {
+                    handler(*_ring->_slots[sequence & _ring->_mask]);
+                }
+
+                if (count > 0)
+                {
+                    _cursor->sequence.store(begin + count);
+                    _ring->_notify_producer();
+                }
+                return count;
+            }
+
+            /**
+             * @brief Like poll, but parks the calling thread until an element is available.
+             *
+             * @return The number of elements handed to handler, 0 once the ring is closed and drained.
+             */
+            template <std::invocable<const T &> Handler>
+            std::size_t read(Handler &&handler, std::size_t max = std::numeric_limits<std::size_t>::max())
+            {
+                while (true)
+                {
+                    if (auto count = poll(handler, max))
+                    {
+                        return count;
+                    }
+
+                    if (_ring->closed())
+                    {
+                        // The producer may have published more before closing.
+                        return poll(handler, max);
+                    }
+
+                    const auto observed = _ring->_consumer_epoch.load();
+                    _ring->_consumers_waiting.fetch_add(1);
+                    if (_ring->_published.load() == _cursor->sequence.load(std::memory_order_relaxed) && !_ring->closed())
+                    {
+                        _ring->_consumer_epoch.wait(observed);
+                    }
+                    _ring->_consumers_waiting.fetch_sub(1);
+                }
+            }
+
+            ~consumer()
+            {
+                if (_cursor)
+                {
+                    _ring->_unsubscribe(_cursor.get());
+                }
+            }
+
+        private:
+            friend class broadcast_ring;
+
+            broadcast_ring *_ring;
+            std::unique_ptr<cursor> _cursor;
+
+            consumer(broadcast_ring &ring, std::unique_ptr<cursor> c) noexcept : _ring(&ring), _cursor(std::move(c)) {}
+        };
+
+        broadcast_ring(std::size_t capacity)
+            : _slots(std::make_unique<std::optional<T>[]>(std::bit_ceil(std::max<std::size_t>(capacity, 1)))),
+              _mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1)
+        {
+        }
+
+        broadcast_ring(const broadcast_ring &) = delete;
+
+        broadcast_ring &operator=(const broadcast_ring &) = delete;
+
+        /**
+         * @brief Subscribes a consumer, it reads every element pushed from now on.
+         */
+        consumer subscribe()
+        {
+            auto c = std::make_unique<cursor>();
+            std::lock_guard lock(_cursors_mutex);
+            c->sequence.store(_published.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            _cursors.push_back(c.get());
+            return consumer(*this, std::move(c));
+        }
+
+        /**
+         * @brief Publishes item unless the slowest consumer still reads the slot it would overwrite or the ring is closed.
+         *
+         * item is left untouched when it returns false.
+         */
+        bool try_push(T &&item)
+        {
+            if (_closed.load(std::memory_order_relaxed) || !_has_room())
+            {
+                return false;
+            }
+
+            _slots[_next & _mask].emplace(std::move(item));
+            _published.store(++_next);
+            _notify_consumers();
+            return true;
+        }
+
+        bool try_push(const T &item)
+        {
+            T copy(item);
+            return try_push(std::move(copy));
+        }
+
+        /**
+         * @brief Publishes item, parking the producer while the slowest consumer is a full ring behind.
+         *
+         * @return false if the ring was closed.
+         */
+        bool push(T &&item)
+        {
+            while (!try_push(std::move(item)))
+            {
+                if (closed())
+                {
+                    return false;
+                }
+
+                const auto observed = _producer_epoch.load();
+                _producer_waiting.store(true);
+                if (!_has_room() && !closed())
+                {
+                    _producer_epoch.wait(observed);
+                }
+                _producer_waiting.store(false);
+            }
+            return true;
+        }
+
+        bool push(const T &item)
+        {
+            T copy(item);
+            return push(std::move(copy));
+        }
+
+        void close() noexcept
+        {
+            _closed.store(true);
+            _producer_epoch.fetch_add(1);
+            _producer_epoch.notify_all();
+            _consumer_epoch.fetch_add(1);
+            _consumer_epoch.notify_all();
+        }
+
+        bool closed() const noexcept
+        {
+            return _closed.load();
+        }
+
+    private:
+        std::unique_ptr<std::optional<T>[]> _slots;
+        const std::size_t _mask;
+        std::atomic<bool> _closed{false};
+
+        std::mutex _cursors_mutex;
+        std::vector<cursor *> _cursors;
+
+        alignas(cache_line_size) std::atomic<std::size_t> _published{0};
+        std::atomic<std::size_t> _consumers_waiting{0};
+        std::atomic<std::uint32_t> _consumer_epoch{0};
+
+        // Only touched by the producer, apart from the flag consumers check after moving their cursor.
+        alignas(cache_line_size) std::size_t _next = 0;
+        std::size_t _cached_gate = 0;
+        std::atomic<bool> _producer_waiting{false};
+        std::atomic<std::uint32_t> _producer_epoch{0};
+
+        /**
+         * @brief Whether slot _next is free, the slowest cursor is only looked up again once the cached one is a lap behind.
+         */
+        bool _has_room()
+        {
+            if (_next - _cached_gate <= _mask)
+            {
+                return true;
+            }
+
+            std::lock_guard lock(_cursors_mutex);
+            _cached_gate = _next;
+            for (auto c : _cursors)
+            {
+                _cached_gate = std::min(_cached_gate, c->sequence.load());
+            }
+            return _next - _cached_gate <= _mask;
+        }
+
+        void _unsubscribe(cursor *c)
+        {
+            {
+                std::lock_guard lock(_cursors_mutex);
+                _cursors.erase(std::find(_cursors.begin(), _cursors.end(), c));
+            }
+            // The producer may have been waiting on this consumer.
+            _producer_epoch.fetch_add(1);
+            _producer_epoch.notify_one();
+        }
+
+        void _notify_producer() noexcept
+        {
+            if (_producer_waiting.load())
+            {
+                _producer_epoch.fetch_add(1);
+                _producer_epoch.notify_one();
+            }
+        }
+
+        void _notify_consumers() noexcept
+        {
+            if (_consumers_waiting.load() > 0)
+            {
+                _consumer_epoch.fetch_add(1);
+                _consumer_epoch.notify_all();
+            }
+        }
+    };
+}
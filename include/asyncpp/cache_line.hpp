@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+namespace async
+{
+    /**
+     * @brief Alignment keeping independently written atomics from sharing a cache line.
+     *
+     * std::hardware_destructive_interference_size is not used since it may differ between translation units.
+     */
+    inline constexpr std::size_t cache_line_size = 64;
+}
@@ -0,0 +1,301 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace async
+{
+    namespace detail
+    {
+        /**
+         * @brief Open addressing hash table keeping its entries densely packed in insertion order.
+         *
+         * The probed table only holds 8 byte slots (a 32 bit hash tag plus the entry index), so lookups
+         * touch one small contiguous array and growing never rehashes or moves the entries themselves.
+         */
+        template <typename Key, typename Entry, typename KeyOf, typename Hash, typename KeyEqual>
+        class flat_hash_table
+        {
+        public:
+            using key_type = Key;
+
+            using value_type = Entry;
+
+            using iterator = typename std::vector<Entry>::iterator;
+
+            using const_iterator = typename std::vector<Entry>::const_iterator;
+
+            flat_hash_table(std::size_t expected_count = 0, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
+                : _hash(hash), _equal(equal)
+            {
+                reserve(expected_count);
+            }
+
+            iterator begin() noexcept
+            {
+                return _entries.begin();
+            }
+
+            const_iterator begin() const noexcept
+            {
+                return _entries.begin();
+            }
+
+            iterator end() noexcept
+            {
+                return _entries.end();
+            }
+
+            const_iterator end() const noexcept
+            {
+                return _entries.end();
+            }
+
+            std::size_t size() const noexcept
+            {
+                return _entries.size();
+            }
+
+            bool empty() const noexcept
+            {
+                return _entries.empty();
+            }
+
+            void reserve(std::size_t count)
+            {
+                _entries.reserve(count);
+                if (count * 2 > _slots.size())
+                {
+                    _rehash(std::bit_ceil(std::max(count * 2, _min_slots)));
+                }
+            }
+
+            bool contains(const Key &key) const
+            {
+                return _find(key) != _empty;
+            }
+
+            iterator find(const Key &key)
+            {
+                auto index = _find(key);
+                return index == _empty ? end() : begin() + index;
+            }
+
+            const_iterator find(const Key &key) const
+            {
+                auto index = _find(key);
+                return index == _empty ? end() : begin() + index;
+            }
+
+            void clear() noexcept
+            {
+                _entries.clear();
+                std::fill(_slots.begin(), _slots.end(), slot{0, _empty});
+            }
+
+            /**
+             * @brief Moves all entries out in insertion order, leaving the table empty.
+             */
+            std::vector<Entry> extract() noexcept
+            {
+                std::fill(_slots.begin(), _slots.end(), slot{0, _empty});
+                return std::exchange(_entries, {});
+            }
+
+        protected:
+            template <typename Factory>
+            std::pair<iterator, bool> _find_or_insert(const Key &key, Factory &&make_entry)
+            {
+                if (_slots.empty())
+                {
+                    _rehash(_min_slots);
+                }
+
+                const auto tag = _tag(key);
+                auto pos = _position(tag);
+                while (_slots[pos].index != _empty)
+                {
+                    const auto &s = _slots[pos];
+                    if (s.tag == tag && _equal(KeyOf{}(_entries[s.index]), key))
+                    {
+                        return {begin() + s.index, false};
+                    }
+                    pos = (pos + 1) & (_slots.size() - 1);
+                }
+
+                if (_entries.size() >= _max_entries)
+                {
+                    throw std::length_error("flat_hash_table");
+                }
+
+                // Keep the load factor at or below one half, linear probing degrades quickly past that.
+                if ((_entries.size() + 1) * 2 > _slots.size())
+                {
+                    _rehash(_slots.size() * 2);
+                    pos = _position(tag);
+                    while (_slots[pos].index != _empty)
+                    {
+                        pos = (pos + 1) & (_slots.size() - 1);
+                    }
+                }
+
+                _entries.push_back(make_entry());
+                _slots[pos] = slot{tag, static_cast<std::uint32_t>(_entries.size() - 1)};
+                return {end() - 1, true};
+            }
+
+        private:
+            struct slot
+            {
+                std::uint32_t tag;
+                std::uint32_t index;
+            };
+
+            static constexpr std::uint32_t _empty = std::numeric_limits<std::uint32_t>::max();
+
+            static constexpr std::size_t _min_slots = 16;
+
+            static constexpr std::size_t _max_entries = _empty - 1;
+
+            std::vector<Entry> _entries;
+            std::vector<slot> _slots;
+            int _shift = 32;
+            [[no_unique_address]] Hash _hash;
+            [[no_unique_address]] KeyEqual _equal;
+
+            std::uint32_t _tag(const Key &key) const
+            {
+                // Fibonacci hashing spreads weak hashes (std::hash of integers is the identity) over the high bits.
+                const auto mixed = static_cast<std::uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull;
+                return static_cast<std::uint32_t>(mixed >> 32);
+            }
+
+            std::size_t _position(std::uint32_t tag) const noexcept
+            {
+                return _shift == 32 ? 0 : tag >> _shift;
+            }
+
+            std::uint32_t _find(const Key &key) const
+            {
+                if (_slots.empty())
+                {
+                    return _empty;
+                }
+
+                const auto tag = _tag(key);
+                auto pos = _position(tag);
+                while (_slots[pos].index != _empty)
+                {
+                    const auto &s = _slots[pos];
+                    if (s.tag == tag && _equal(KeyOf{}(_entries[s.index]), key))
+                    {
+                        return s.index;
+                    }
+                    pos = (pos + 1) & (_slots.size() - 1);
+                }
+                return _empty;
+            }
+
+            void _rehash(std::size_t slot_count)
+            {
+                // The slot position is the top bits of the tag, so entries never have to be hashed again.
+                auto old_slots = std::exchange(_slots, std::vector<slot>(slot_count, slot{0, _empty}));
+                _shift = 32 - std::countr_zero(slot_count);
+                for (const auto &s : old_slots)
+                {
+                    if (s.index == _empty)
+                    {
+                        continue;
+                    }
+
+                    auto pos = _position(s.tag);
+                    while (_slots[pos].index != _empty)
+                    {
+                        pos = (pos + 1) & (slot_count - 1);
+                    }
+                    _slots[pos] = s;
+                }
+            }
+        };
+
+        struct identity_key
+        {
+            template <typename T>
+            const T &operator()(const T &value) const noexcept
+            {
+                return value;
+            }
+        };
+
+        struct first_key
+        {
+            template <typename Pair>
+            const auto &operator()(const Pair &value) const noexcept
+            {
+                return value.first;
+            }
+        };
+    }
+
+    template <typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class flat_hash_set : public detail::flat_hash_table<Key, Key, detail::identity_key, Hash, KeyEqual>
+    {
+    public:
+        using detail::flat_hash_table<Key, Key, detail::identity_key, Hash, KeyEqual>::flat_hash_table;
+
+        using iterator = typename detail::flat_hash_table<Key, Key, detail::identity_key, Hash, KeyEqual>::iterator;
+
+        std::pair<iterator, bool> insert(const Key &key)
+        {
+            return this->_find_or_insert(key, [&]
+                                         { return key; });
+        }
+
+        std::pair<iterator, bool> insert(Key &&key)
+        {
+            return this->_find_or_insert(key, [&]
+                                         { return std::move(key); });
+        }
+    };
+
+    /**
+     * @brief Keys must not be modified through the iterators.
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class flat_hash_map : public detail::flat_hash_table<Key, std::pair<Key, Value>, detail::first_key, Hash, KeyEqual>
+    {
+    public:
+        using detail::flat_hash_table<Key, std::pair<Key, Value>, detail::first_key, Hash, KeyEqual>::flat_hash_table;
+
+        using iterator = typename detail::flat_hash_table<Key, std::pair<Key, Value>, detail::first_key, Hash, KeyEqual>::iterator;
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const Key &key, Args &&...args)
+        {
+            return this->_find_or_insert(key, [&]
+                                         { return std::pair<Key, Value>(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...)); });
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(Key &&key, Args &&...args)
+        {
+            return this->_find_or_insert(key, [&]
+                                         { return std::pair<Key, Value>(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...)); });
+        }
+
+        Value &operator[](const Key &key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        Value &operator[](Key &&key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+    };
+}
@@ -1,14 +1,116 @@
 #pragma once
+#include <chrono>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "../generator.hpp"
 #include "../task.hpp"
 
 namespace async::fs
 {
+    namespace detail
+    {
+        /**
+         * @brief The FILE_ATTRIBUTE_* values of Windows, the POSIX backend maps a stat result onto the same bits.
+         */
+        namespace file_attribute
+        {
+            inline constexpr std::uint32_t read_only = 0x1;
+            inline constexpr std::uint32_t hidden = 0x2;
+            inline constexpr std::uint32_t system = 0x4;
+            inline constexpr std::uint32_t directory = 0x10;
+            inline constexpr std::uint32_t archive = 0x20;
+            inline constexpr std::uint32_t device = 0x40;
+            inline constexpr std::uint32_t normal = 0x80;
+            inline constexpr std::uint32_t temporary = 0x100;
+            inline constexpr std::uint32_t sparse_file = 0x200;
+            inline constexpr std::uint32_t reparse_point = 0x400;
+            inline constexpr std::uint32_t compressed = 0x800;
+            inline constexpr std::uint32_t offline = 0x1000;
+            inline constexpr std::uint32_t not_content_indexed = 0x2000;
+            inline constexpr std::uint32_t encrypted = 0x4000;
+            inline constexpr std::uint32_t integrity_stream = 0x8000;
+            inline constexpr std::uint32_t virtual_ = 0x10000;
+            inline constexpr std::uint32_t no_scrub_data = 0x20000;
+            inline constexpr std::uint32_t recall_on_open = 0x40000;
+            inline constexpr std::uint32_t recall_on_data_access = 0x400000;
+            inline constexpr std::uint32_t invalid = 0xFFFFFFFF;
+        }
+
+#ifndef _WIN32
+        /**
+         * @brief Owns a file descriptor, closing it when destroyed.
+         */
+        class file_descriptor
+        {
+        public:
+            explicit file_descriptor(int fd) noexcept : _fd(fd) {}
+
+            file_descriptor(const file_descriptor &) = delete;
+
+            file_descriptor &operator=(const file_descriptor &) = delete;
+
+            ~file_descriptor()
+            {
+                ::close(_fd);
+            }
+
+            int get() const noexcept
+            {
+                return _fd;
+            }
+
+        private:
+            int _fd;
+        };
+
+        /**
+         * @brief Opens path with O_CLOEXEC, throwing std::system_error with what on failure.
+         */
+        inline file_descriptor open_file(const char *path, int flags, const char *what)
+        {
+            int fd;
+            do
+            {
+                fd = ::open(path, flags | O_CLOEXEC);
+            } while (fd < 0 && errno == EINTR);
+
+            if (fd < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), what);
+            }
+            return file_descriptor(fd);
+        }
+
+        inline std::chrono::sys_time<std::chrono::seconds> to_sys_seconds(std::int64_t seconds) noexcept
+        {
+            return std::chrono::sys_time<std::chrono::seconds>(std::chrono::seconds(seconds));
+        }
+#endif
+    }
+
     template <typename StringType = std::string>
     class path
     {
+#ifndef _WIN32
+        static_assert(std::is_same_v<StringType, std::string>, "Only std::string paths are supported on POSIX");
+#endif
+
     public:
         using CharType = typename StringType::value_type;
 
@@ -24,102 +126,102 @@ namespace async::fs
 
             bool is_archive() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_ARCHIVE);
+                return (_flags & detail::file_attribute::archive);
             }
 
             bool is_compressed() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_COMPRESSED);
+                return (_flags & detail::file_attribute::compressed);
             }
 
             bool is_device() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_DEVICE);
+                return (_flags & detail::file_attribute::device);
             }
 
             bool is_directory() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_DIRECTORY);
+                return (_flags & detail::file_attribute::directory);
             }
 
             bool is_encrypted() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_ENCRYPTED);
+                return (_flags & detail::file_attribute::encrypted);
             }
 
             bool is_hidden() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_HIDDEN);
+                return (_flags & detail::file_attribute::hidden);
             }
 
             bool is_integrity_stream() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_INTEGRITY_STREAM);
+                return (_flags & detail::file_attribute::integrity_stream);
             }
 
             bool is_normal() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_NORMAL);
+                return (_flags & detail::file_attribute::normal);
             }
 
             bool is_not_content_indexed() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_NOT_CONTENT_INDEXED);
+                return (_flags & detail::file_attribute::not_content_indexed);
             }
 
             bool is_no_scrub_data() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_NO_SCRUB_DATA);
+                return (_flags & detail::file_attribute::no_scrub_data);
             }
 
             bool is_offline() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_OFFLINE);
+                return (_flags & detail::file_attribute::offline);
             }
 
             bool is_read_only() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_READONLY);
+                return (_flags & detail::file_attribute::read_only);
             }
 
             bool is_recall_on_data_access() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS);
+                return (_flags & detail::file_attribute::recall_on_data_access);
             }
 
             bool is_recall_on_open() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_RECALL_ON_OPEN);
+                return (_flags & detail::file_attribute::recall_on_open);
             }
 
             bool is_reparse_point() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_REPARSE_POINT);
+                return (_flags & detail::file_attribute::reparse_point);
             }
 
             bool is_sparse_file() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_SPARSE_FILE);
+                return (_flags & detail::file_attribute::sparse_file);
             }
 
             bool is_system() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_SYSTEM);
+                return (_flags & detail::file_attribute::system);
             }
 
             bool is_temporary() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_TEMPORARY);
+                return (_flags & detail::file_attribute::temporary);
             }
 
             bool is_virtual() const noexcept
             {
-                return (_flags & FILE_ATTRIBUTE_VIRTUAL);
+                return (_flags & detail::file_attribute::virtual_);
             }
 
             bool exists() const noexcept
             {
-                return (_flags != INVALID_FILE_ATTRIBUTES);
+                return (_flags != detail::file_attribute::invalid);
             }
 
         private:
@@ -160,6 +262,7 @@ namespace async::fs
             return *this;
         }
 
+#ifdef _WIN32
         attributes get_attributes() const
         {
             if constexpr (std::is_same_v<StringType, std::wstring>)
@@ -187,7 +290,7 @@ namespace async::fs
             }
             else
             {
-                static_assert(false, "Unsupported StringType");
+                static_assert(sizeof(StringType) == 0, "Unsupported StringType");
             }
 
             auto err = GetLastError();
@@ -217,7 +320,7 @@ namespace async::fs
             }
             else
             {
-                static_assert(false, "Unsupported StringType");
+                static_assert(sizeof(StringType) == 0, "Unsupported StringType");
             }
 
             auto err = GetLastError();
@@ -247,7 +350,7 @@ namespace async::fs
             }
             else
             {
-                static_assert(false, "Unsupported StringType");
+                static_assert(sizeof(StringType) == 0, "Unsupported StringType");
             }
 
             auto err = GetLastError();
@@ -262,6 +365,94 @@ namespace async::fs
             return std::chrono::sys_time<std::chrono::seconds>(std::chrono::seconds(*(std::uint64_t *)&last_write_time / 10000000 - 11644473600));
         }
 
+#else
+        /**
+         * @brief Maps lstat onto the Windows attribute bits, a symbolic link is a reparse point typed like its target.
+         *
+         * Dot files are hidden, files without any write permission bit are read only.
+         */
+        attributes get_attributes() const
+        {
+            struct stat status;
+            if (::lstat(_text.c_str(), &status) != 0)
+            {
+                return attributes(detail::file_attribute::invalid);
+            }
+
+            std::uint32_t flags = 0;
+            if (S_ISLNK(status.st_mode))
+            {
+                flags |= detail::file_attribute::reparse_point;
+                struct stat target;
+                if (::stat(_text.c_str(), &target) == 0)
+                {
+                    status = target;
+                }
+            }
+
+            if (S_ISDIR(status.st_mode))
+            {
+                flags |= detail::file_attribute::directory;
+            }
+            else if (S_ISCHR(status.st_mode) || S_ISBLK(status.st_mode))
+            {
+                flags |= detail::file_attribute::device;
+            }
+            else if (S_ISREG(status.st_mode) && static_cast<std::int64_t>(status.st_blocks) * 512 < static_cast<std::int64_t>(status.st_size))
+            {
+                flags |= detail::file_attribute::sparse_file;
+            }
+
+            if ((status.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0)
+            {
+                flags |= detail::file_attribute::read_only;
+            }
+
+            if (file_name().starts_with('.'))
+            {
+                flags |= detail::file_attribute::hidden;
+            }
+
+            if (flags == 0 && S_ISREG(status.st_mode))
+            {
+                flags = detail::file_attribute::normal;
+            }
+            return attributes(flags);
+        }
+
+        /**
+         * @brief The birth time reported by statx, the status change time where the file system does not record one.
+         */
+        std::chrono::sys_time<std::chrono::seconds> get_creation_time() const
+        {
+#if defined(__linux__) && defined(STATX_BTIME)
+            struct statx status;
+            if (::statx(AT_FDCWD, _text.c_str(), 0, STATX_BTIME | STATX_CTIME, &status) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "Failed to get creation time");
+            }
+
+            if (status.stx_mask & STATX_BTIME)
+            {
+                return detail::to_sys_seconds(status.stx_btime.tv_sec);
+            }
+            return detail::to_sys_seconds(status.stx_ctime.tv_sec);
+#else
+            return detail::to_sys_seconds(_stat("Failed to get creation time").st_ctime);
+#endif
+        }
+
+        std::chrono::sys_time<std::chrono::seconds> get_last_access_time() const
+        {
+            return detail::to_sys_seconds(_stat("Failed to get last access time").st_atime);
+        }
+
+        std::chrono::sys_time<std::chrono::seconds> get_last_write_time() const
+        {
+            return detail::to_sys_seconds(_stat("Failed to get last write time").st_mtime);
+        }
+#endif
+
         StringType file_name() const
         {
             auto pos = _text.find_last_of(_preferred_seperator());
@@ -275,6 +466,7 @@ namespace async::fs
             return StringType(_text.begin() + pos + 1, end);
         }
 
+#ifdef _WIN32
         bool is_absolute() const
         {
             return _contains_drive_letter() && (_text.size() >= 3 && _is_slash(_text[2]));
@@ -295,7 +487,7 @@ namespace async::fs
             }
             else
             {
-                static_assert(false, "Unsupported StringType");
+                static_assert(sizeof(StringType) == 0, "Unsupported StringType");
             }
 
             if (handle == INVALID_HANDLE_VALUE)
@@ -323,6 +515,66 @@ namespace async::fs
             return buffer;
         }
 
+#else
+        bool is_absolute() const
+        {
+            return !_text.empty() && _is_slash(_text[0]);
+        }
+
+        /**
+         * @brief Reads the whole file with pread, sized by a single fstat and hinted as a sequential read.
+         *
+         * Files reporting no size, like those under /proc, are read until end of file instead.
+         */
+        std::vector<std::byte> read_file() const
+        {
+            auto fd = detail::open_file(_text.c_str(), O_RDONLY, "Failed to read file");
+
+            struct stat status;
+            if (::fstat(fd.get(), &status) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "Failed to get file size");
+            }
+
+            ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            const bool sized = status.st_size > 0;
+            std::vector<std::byte> buffer(sized ? static_cast<std::size_t>(status.st_size) : 4096);
+            std::size_t length = 0;
+            while (true)
+            {
+                if (length == buffer.size())
+                {
+                    if (sized)
+                    {
+                        break;
+                    }
+                    buffer.resize(buffer.size() * 2);
+                }
+
+                const auto count = ::pread(fd.get(), buffer.data() + length, buffer.size() - length, static_cast<off_t>(length));
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "Failed to read file");
+                }
+
+                if (count == 0)
+                {
+                    // The file shrank since fstat, or an unsized file ended.
+                    break;
+                }
+                length += static_cast<std::size_t>(count);
+            }
+
+            buffer.resize(length);
+            return buffer;
+        }
+#endif
+
         task<std::vector<std::byte>> read_file_async() const
         {
             co_return read_file();
@@ -339,6 +591,7 @@ namespace async::fs
             co_return read_file_text();
         }
 
+#ifdef _WIN32
         generator<path> walk_directory() const
         {
             WIN32_FIND_DATA find_data;
@@ -356,7 +609,7 @@ namespace async::fs
             }
             else
             {
-                static_assert(false, "Unsupported StringType");
+                static_assert(sizeof(StringType) == 0, "Unsupported StringType");
             }
 
             if (handle == INVALID_HANDLE_VALUE)
@@ -373,52 +626,141 @@ namespace async::fs
             FindClose(handle);
         }
 
-        std::string_view parent_path() const
+#else
+        /**
+         * @brief Yields the entries of the directory, without "." and "..".
+         *
+         * On Linux the entries are read in large batches with getdents64, elsewhere through readdir.
+         */
+        generator<path> walk_directory() const
         {
-            auto pos = _text.find_last_of(_preferred_seperator());
-            if (pos == std::string::npos)
+#if defined(__linux__)
+            auto fd = detail::open_file(_text.c_str(), O_RDONLY | O_DIRECTORY, "Failed to walk directory");
+            std::vector<char> buffer(32 * 1024);
+            while (true)
+            {
+                const auto count = ::getdents64(fd.get(), buffer.data(), buffer.size());
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "Failed to walk directory");
+                }
+
+                if (count == 0)
+                {
+                    break;
+                }
+
+                for (std::size_t offset = 0; offset < static_cast<std::size_t>(count);)
+                {
+                    const auto *entry = reinterpret_cast<const struct dirent64 *>(buffer.data() + offset);
+                    offset += entry->d_reclen;
+                    if (!_is_dot_entry(entry->d_name))
+                    {
+                        co_yield path(_text + _preferred_seperator() + entry->d_name);
+                    }
+                }
+            }
+#else
+            std::unique_ptr<DIR, decltype(&::closedir)> directory(::opendir(_text.c_str()), &::closedir);
+            if (directory == nullptr)
             {
-                return std::string_view();
+                throw std::system_error(errno, std::generic_category(), "Failed to walk directory");
             }
 
-            return std::string_view(_text.data(), pos);
+            while (const auto *entry = ::readdir(directory.get()))
+            {
+                if (!_is_dot_entry(entry->d_name))
+                {
+                    co_yield path(_text + _preferred_seperator() + entry->d_name);
+                }
+            }
+#endif
         }
+#endif
 
-        std::string_view stem() const
+        /**
+         * @brief Appends other after a separator, an absolute other replaces the path like std::filesystem::path.
+         */
+        path &operator/=(const path &other)
         {
-            auto pos = _text.find_last_of(_preferred_seperator());
-            if (pos == std::string::npos)
+            if (_text.empty() || other.is_absolute() || other._contains_root_name())
             {
-                return _text;
+                _text = other._text;
+                return *this;
             }
 
-            auto end = _text.end();
-            auto ext_pos = _text.find_last_of('.');
-            if(ext_pos == std::string::npos)
+            if (!other._text.empty() && !_is_slash(_text.back()))
             {
-                return std::string_view(_text.data() + (pos + 1), _text.size());
+                _text += _preferred_seperator();
             }
+            _text += other._text;
+            return *this;
+        }
 
-            return std::string_view(_text.data() + (pos + 1), ext_pos - (pos + 1));
+        friend path operator/(path lhs, const path &rhs)
+        {
+            lhs /= rhs;
+            return lhs;
         }
 
-        std::string_view extension() const
+        const StringType &native() const noexcept
         {
-            auto pos = _text.find_last_of('.');
-            if (pos == std::string::npos)
+            return _text;
+        }
+
+        /**
+         * @brief The root of an absolute path, "/" on POSIX and the drive with its separator on Windows.
+         */
+        std::basic_string_view<CharType> root_path() const
+        {
+            if (_contains_root_name())
+            {
+                return std::basic_string_view<CharType>(_text.data(), is_absolute() ? 3 : 2);
+            }
+            if (is_absolute())
             {
-                return std::string_view();
+                return std::basic_string_view<CharType>(_text.data(), 1);
             }
+            return std::basic_string_view<CharType>();
+        }
 
-            auto end = _text.end();
-            auto ext_pos = _text.find_last_of('.');
-            if (ext_pos == std::string::npos)
+        std::basic_string_view<CharType> parent_path() const
+        {
+            auto pos = _text.find_last_of(_preferred_seperator());
+            if (pos == StringType::npos)
             {
-                return std::string_view();
+                return std::basic_string_view<CharType>();
             }
 
-            return std::string_view(_text.data() + (pos + 1), _text.size());
+            return std::basic_string_view<CharType>(_text.data(), pos);
         }
+
+        /**
+         * @brief The file name without its extension.
+         */
+        std::basic_string_view<CharType> stem() const
+        {
+            const auto name = _file_name_start();
+            return std::basic_string_view<CharType>(_text.data() + name, _extension_start() - name);
+        }
+
+        /**
+         * @brief What follows the last dot of the file name, without the dot. Dot files such as ".profile" have none.
+         */
+        std::basic_string_view<CharType> extension() const
+        {
+            const auto dot = _extension_start();
+            if (dot == _text.size())
+            {
+                return std::basic_string_view<CharType>();
+            }
+            return std::basic_string_view<CharType>(_text.data() + dot + 1, _text.size() - (dot + 1));
+        }
+
     private:
         StringType _text;
 
@@ -442,13 +784,66 @@ namespace async::fs
             return _text.size() > 2 && _text[1] == ':';
         }
 
+        bool _contains_root_name() const
+        {
+#ifdef _WIN32
+            return _text.size() >= 2 && _text[1] == ':';
+#else
+            return false;
+#endif
+        }
+
+        std::size_t _file_name_start() const noexcept
+        {
+            const auto pos = _text.find_last_of(_preferred_seperator());
+            return pos == StringType::npos ? 0 : pos + 1;
+        }
+
+        /**
+         * @brief Position of the dot starting the extension, the size of the text if there is none.
+         */
+        std::size_t _extension_start() const noexcept
+        {
+            const auto name = _file_name_start();
+            const auto dot = _text.find_last_of('.');
+            if (dot == StringType::npos || dot <= name)
+            {
+                return _text.size();
+            }
+
+            // ".." names a directory, it has no extension.
+            if (dot == name + 1 && _text[name] == '.' && dot + 1 == _text.size())
+            {
+                return _text.size();
+            }
+            return dot;
+        }
+
         bool _is_slash(CharType c) const
         {
             return c == _preferred_seperator();
         }
 
+#ifndef _WIN32
+        struct stat _stat(const char *what) const
+        {
+            struct stat status;
+            if (::stat(_text.c_str(), &status) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), what);
+            }
+            return status;
+        }
+
+        static bool _is_dot_entry(std::string_view name) noexcept
+        {
+            return name == "." || name == "..";
+        }
+#endif
+
         auto _preferred_seperator() const
         {
+#ifdef _WIN32
             if constexpr (std::is_same_v<StringType, std::string>)
             {
                 return '\\';
@@ -457,9 +852,15 @@ namespace async::fs
             {
                 return L'\\';
             }
+#else
+            if constexpr (std::is_same_v<StringType, std::string>)
+            {
+                return '/';
+            }
+#endif
             else
             {
-                static_assert(false, "Unsupported string type");
+                static_assert(sizeof(StringType) == 0, "Unsupported string type");
             }
         }
     };
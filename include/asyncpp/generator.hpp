@@ -1,18 +1,53 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <concepts>
 #include <coroutine>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
 #include <iterator>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <set>
 #include <execution>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include "flat_hash_map.hpp"
+#include "simd.hpp"
+#include "spsc_ring.hpp"
 #include "task.hpp"
 
 namespace async
 {
     template <typename T>
-    class generator
+    class batch_generator;
+
+    /**
+     * @brief Wraps a generator or range so that co_yield yields all of its elements in place.
+     */
+    template <typename Range>
+    struct elements_of
+    {
+        Range range;
+    };
+
+    template <typename Range>
+    elements_of(Range &&) -> elements_of<Range &&>;
+
+    template <typename T>
+    class generator : public std::ranges::view_base
     {
+        struct contiguous_source;
+
     public:
         class promise_type
         {
@@ -21,7 +56,8 @@ namespace async
 
             generator<T> get_return_object() noexcept
             {
-                return generator<T>(std::coroutine_handle<promise_type>::from_promise(*this));
+                _leaf = std::coroutine_handle<promise_type>::from_promise(*this);
+                return generator<T>(_leaf);
             }
 
             std::suspend_always initial_suspend() const noexcept
@@ -29,9 +65,28 @@ namespace async
                 return {};
             }
 
-            std::suspend_always final_suspend() const noexcept
+            auto final_suspend() noexcept
             {
-                return {};
+                class awaiter : public std::suspend_always
+                {
+                public:
+                    awaiter() = default;
+
+                    // A nested generator hands control straight back to the one that yielded its elements.
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                    {
+                        auto &promise = h.promise();
+                        if (!promise._parent)
+                        {
+                            return std::noop_coroutine();
+                        }
+
+                        promise._root->_leaf = promise._parent;
+                        return promise._parent;
+                    }
+                };
+
+                return awaiter();
             }
 
             void unhandled_exception() noexcept
@@ -49,31 +104,115 @@ namespace async
 
             void return_void() {}
 
-            std::suspend_always yield_value(const T &value) noexcept
+            // Yielded rvalues are referenced where they are, they outlive the suspension of the co_yield.
+            std::suspend_always yield_value(T &&value) noexcept
             {
-                _value = value;
+                _value = std::addressof(value);
                 return {};
             }
 
-            std::suspend_always yield_value(T &&value) noexcept
+            // Yielded lvalues are copied into the awaiter so consumers may move from them.
+            auto yield_value(const T &value) noexcept(std::is_nothrow_copy_constructible_v<T>)
             {
-                _value = std::move(value);
-                return {};
+                class awaiter : public std::suspend_always
+                {
+                public:
+                    awaiter(const T &value, promise_type &promise)
+                        : _copy(value), _promise(promise)
+                    {
+                    }
+
+                    void await_suspend(std::coroutine_handle<promise_type>) noexcept
+                    {
+                        _promise._value = std::addressof(_copy);
+                    }
+
+                private:
+                    T _copy;
+                    promise_type &_promise;
+                };
+
+                return awaiter(value, *this);
+            }
+
+            template <typename Range>
+            auto yield_value(elements_of<Range> nested)
+            {
+                class awaiter
+                {
+                public:
+                    awaiter(generator<T> &&child) noexcept
+                        : _child(std::move(child))
+                    {
+                    }
+
+                    bool await_ready() const noexcept
+                    {
+                        return !_child._handle;
+                    }
+
+                    // Link the child below the yielding generator, consumers resume it directly until it finishes.
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                    {
+                        auto &child = _child._handle.promise();
+                        child._parent = h;
+                        child._root = h.promise()._root;
+                        child._root->_leaf = _child._handle;
+                        return _child._handle;
+                    }
+
+                    void await_resume() const
+                    {
+                        if (_child._handle)
+                        {
+                            _child._handle.promise().rethrow_if_unhandled_exception();
+                        }
+                    }
+
+                private:
+                    generator<T> _child;
+                };
+
+                using range_type = std::remove_cvref_t<Range>;
+                if constexpr (std::is_same_v<range_type, generator<T>>)
+                {
+                    return awaiter(_as_coroutine(std::move(nested.range)));
+                }
+                else
+                {
+                    return awaiter(_as_coroutine(generator<T>(std::forward<Range>(nested.range))));
+                }
             }
 
             T &get_value() noexcept
             {
-                return _value;
+                return *_leaf.promise()._value;
+            }
+
+            std::coroutine_handle<promise_type> leaf() const noexcept
+            {
+                return _leaf;
             }
 
         private:
-            T _value;
+            T *_value = nullptr;
             std::exception_ptr _exception;
+            promise_type *_root = this;
+            std::coroutine_handle<promise_type> _parent;
+            std::coroutine_handle<promise_type> _leaf;
         };
 
         class iterator
         {
         public:
+            using iterator_concept = std::input_iterator_tag;
+
+            using value_type = T;
+
+            using difference_type = std::ptrdiff_t;
+
+            using reference = T &;
+
             iterator() = default;
 
 
@@ -82,8 +221,17 @@ namespace async
             {
             }
 
+            iterator(contiguous_source *source) noexcept
+                : _source(source)
+            {
+            }
+
             bool operator==(const std::default_sentinel_t &) const noexcept
             {
+                if (_source)
+                {
+                    return _source->first == _source->last;
+                }
                 return !_handle || _handle.done();
             }
 
@@ -92,25 +240,37 @@ namespace async
                 return !(*this == sent);
             }
 
-            iterator &operator++() noexcept
+            iterator &operator++()
             {
-                _handle.resume();
+                if (_source)
+                {
+                    _source->advance();
+                    return *this;
+                }
+
+                _handle.promise().leaf().resume();
                 _handle.promise().rethrow_if_unhandled_exception();
                 return *this;
             }
 
+            void operator++(int)
+            {
+                ++*this;
+            }
+
             T &operator*() const noexcept
             {
-                return _handle.promise().get_value();
+                return _source ? _source->get() : _handle.promise().get_value();
             }
 
             T *operator->() const noexcept
             {
-                return std::addressof(_handle.promise().get_value());
+                return std::addressof(**this);
             }
 
         private:
             std::coroutine_handle<promise_type> _handle;
+            contiguous_source *_source = nullptr;
         };
 
         generator() = default;
@@ -120,45 +280,101 @@ namespace async
         {
         }
 
-        generator(const std::ranges::range auto &range) noexcept
+        /**
+         * @brief Generates the elements of a range, lvalue ranges are referenced and have to outlive the generator.
+         *
+         * Contiguous ranges of T are walked directly by the iterator without creating a coroutine.
+         * Elements of rvalue ranges are moved out, elements of lvalue ranges are copied.
+         */
+        template <std::ranges::range Range>
+            requires(!std::same_as<std::remove_cvref_t<Range>, generator>)
+        generator(Range &&range) noexcept
         {
-            *this = [](const std::ranges::range auto &range_) -> generator<T>
+            std::optional<std::size_t> hint;
+            if constexpr (std::ranges::sized_range<Range>)
             {
-                for (const auto &value : range_)
-                {
-                    co_yield value;
-                }
-            }(range);
-        }
+                hint = std::ranges::size(range);
+            }
 
-        generator(std::ranges::range auto &&range) noexcept
-        {
-            *this = [](std::ranges::range auto range_) -> generator<T>
+            if constexpr (std::ranges::contiguous_range<Range> && std::ranges::sized_range<Range> &&
+                          std::same_as<std::ranges::range_value_t<Range>, T> && std::copy_constructible<T>)
             {
-                auto iter = std::make_move_iterator(std::ranges::begin(range_));
-                auto end = std::make_move_iterator(std::ranges::end(range_));
-                while (iter != end)
+                _source = std::make_unique<contiguous_source>();
+                if constexpr (std::is_lvalue_reference_v<Range>)
+                {
+                    _source->first = std::ranges::data(range);
+                    _source->last = _source->first + std::ranges::size(range);
+                    _source->borrowed = true;
+                }
+                else
                 {
-                    co_yield std::move(*iter++);
+                    auto owner = std::make_shared<std::remove_cvref_t<Range>>(std::move(range));
+                    _source->first = std::ranges::data(*owner);
+                    _source->last = _source->first + std::ranges::size(*owner);
+                    // Views such as std::span only refer to the elements, those must not be moved from.
+                    _source->borrowed = std::ranges::borrowed_range<Range> ||
+                                        std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<Range>>>;
+                    _source->owner = std::move(owner);
                 }
-            }(std::move(range));
+            }
+            else if constexpr (std::is_lvalue_reference_v<Range>)
+            {
+                *this = [](Range range_) -> generator<T>
+                {
+                    for (auto &&value : range_)
+                    {
+                        co_yield std::as_const(value);
+                    }
+                }(range);
+            }
+            else
+            {
+                *this = [](std::remove_cvref_t<Range> range_) -> generator<T>
+                {
+                    for (auto &&value : range_)
+                    {
+                        co_yield std::move(value);
+                    }
+                }(std::move(range));
+            }
+            _size_hint = hint;
         }
 
         generator(generator &&other) noexcept
-            : _handle(std::exchange(other._handle, nullptr))
+            : _handle(std::exchange(other._handle, nullptr)),
+              _source(std::move(other._source)),
+              _size_hint(std::exchange(other._size_hint, std::nullopt))
         {
         }
 
         generator<T> &operator=(generator &&other) noexcept
         {
-            _handle = std::exchange(other._handle, nullptr);
+            if (this != &other)
+            {
+                if (_handle)
+                {
+                    _handle.destroy();
+                }
+                _handle = std::exchange(other._handle, nullptr);
+                _source = std::move(other._source);
+                _size_hint = std::exchange(other._size_hint, std::nullopt);
+            }
             return *this;
         }
 
-        iterator begin() const noexcept
+        iterator begin() const
         {
-            _handle.resume();
-            _handle.promise().rethrow_if_unhandled_exception();
+            if (_source)
+            {
+                _source->load();
+                return iterator(_source.get());
+            }
+
+            if (_handle)
+            {
+                _handle.promise().leaf().resume();
+                _handle.promise().rethrow_if_unhandled_exception();
+            }
             return iterator(_handle);
         }
 
@@ -167,6 +383,14 @@ namespace async
             return {};
         }
 
+        /**
+         * @brief The exact number of elements left, if known without running the generator.
+         */
+        std::optional<std::size_t> size_hint() const noexcept
+        {
+            return _size_hint;
+        }
+
         bool all(std::invocable<T &&> auto &&pred) const
         {
             for (auto &&value : *this)
@@ -193,71 +417,134 @@ namespace async
 
         generator<T> append(const T &value)
         {
-            return [](generator<T> gen_, T value_) -> generator<T>
+            auto hint = _add_size_hints(_size_hint, 1);
+            return _with_size_hint([](generator<T> gen_, T value_) -> generator<T>
             {
-                for (auto &&v : gen_)
-                {
-                    co_yield v;
-                }
-                co_yield value_;
-            }(std::move(*this), value);
+                co_yield elements_of(std::move(gen_));
+                co_yield std::move(value_);
+            }(std::move(*this), value), hint);
         }
 
         generator<T> append(T &&value)
         {
-            return [](generator<T> gen_, T value_) -> generator<T>
+            auto hint = _add_size_hints(_size_hint, 1);
+            return _with_size_hint([](generator<T> gen_, T value_) -> generator<T>
             {
-                for (auto &&v : gen_)
-                {
-                    co_yield v;
-                }
-                co_yield value_;
-            }(std::move(*this), std::move(value));
+                co_yield elements_of(std::move(gen_));
+                co_yield std::move(value_);
+            }(std::move(*this), std::move(value)), hint);
         }
 
         generator<T> append(generator<T> &&other)
         {
-            return [](generator<T> gen_, generator<T> other_) -> generator<T>
+            auto hint = _add_size_hints(_size_hint, other._size_hint);
+            return _with_size_hint([](generator<T> gen_, generator<T> other_) -> generator<T>
+            {
+                co_yield elements_of(std::move(gen_));
+                co_yield elements_of(std::move(other_));
+            }(std::move(*this), std::move(other)), hint);
+        }
+
+        template <typename KeySelector,
+                  typename Accumulate,
+                  typename Key = std::remove_cvref_t<std::invoke_result_t<KeySelector, const T &>>,
+                  typename Hash = std::hash<Key>,
+                  typename KeyEqual = std::equal_to<Key>>
+            requires std::invocable<KeySelector, const T &>
+        generator<std::pair<Key, Accumulate>> aggregate_by(KeySelector &&key_selector, Accumulate init, std::invocable<Accumulate &&, T &&> auto &&fold, std::size_t expected_groups = 0, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
+        {
+            return [](generator<T> gen_, auto key_selector_, Accumulate init_, auto fold_, flat_hash_map<Key, Accumulate, Hash, KeyEqual> groups_) -> generator<std::pair<Key, Accumulate>>
             {
                 for (auto &&v : gen_)
                 {
-                    co_yield v;
+                    auto &acc = groups_.try_emplace(key_selector_(std::as_const(v)), init_).first->second;
+                    acc = fold_(std::move(acc), std::move(v));
                 }
-                for (auto &&v : other_)
+
+                for (auto &&group : groups_.extract())
                 {
-                    co_yield v;
+                    co_yield std::move(group);
                 }
-            }(std::move(*this), std::move(other));
+            }(std::move(*this), std::forward<KeySelector>(key_selector), std::move(init), std::forward<decltype(fold)>(fold), flat_hash_map<Key, Accumulate, Hash, KeyEqual>(expected_groups, hash, equal));
         }
 
-        template <std::integral U = T>
-        double average()
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        double average(summation mode = summation::pairwise)
         {
-            std::size_t count = 0;
-            double sum = 0;
-            for (auto &&value : *this)
+            return batch().average(mode);
+        }
+
+        batch_generator<T> batch(std::size_t size = 1024)
+        {
+            if (_source)
             {
-                sum += value;
-                ++count;
+                // Blocks can point straight into the source range.
+                return [](generator<T> gen_, std::size_t size_) -> generator<std::span<const T>>
+                {
+                    auto first = gen_._source->first;
+                    auto last = gen_._source->last;
+                    while (first != last)
+                    {
+                        auto size = std::min<std::size_t>(size_, last - first);
+                        co_yield std::span<const T>(first, size);
+                        first += size;
+                    }
+                }(std::move(*this), size);
             }
-            return sum / count;
+
+            return [](generator<T> gen_, std::size_t size_) -> generator<std::span<const T>>
+            {
+                std::vector<T> buffer;
+                buffer.reserve(size_);
+                for (auto &&v : gen_)
+                {
+                    buffer.push_back(std::move(v));
+                    if (buffer.size() == size_)
+                    {
+                        co_yield std::span<const T>(buffer);
+                        buffer.clear();
+                    }
+                }
+
+                if (!buffer.empty())
+                {
+                    co_yield std::span<const T>(buffer);
+                }
+            }(std::move(*this), size);
         }
 
+        /**
+         * @brief Groups consecutive elements into vectors of size elements, the last one may be smaller.
+         */
         generator<std::vector<T>> chunk(std::size_t size)
         {
-            return [](generator<T> gen_, std::size_t size_) -> generator<std::vector<T>>
+            if (size == 0)
+            {
+                throw std::invalid_argument("chunk");
+            }
+
+            auto hint = _size_hint ? std::optional<std::size_t>((*_size_hint + size - 1) / size) : std::nullopt;
+            return _with_size_hint([](generator<T> gen_, std::size_t size_) -> generator<std::vector<T>>
             {
                 std::vector<T> result;
                 result.reserve(size_);
                 for (auto &&v : gen_)
                 {
-                    result.push_back(v);
+                    result.push_back(std::move(v));
                     if (result.size() == size_)
                     {
                         co_yield std::move(result);
+                        result = std::vector<T>();
+                        result.reserve(size_);
                     }
                 }
-            }(std::move(*this), size);
+
+                if (!result.empty())
+                {
+                    co_yield std::move(result);
+                }
+            }(std::move(*this), size), hint);
         }
 
         bool contains(const T &value) const
@@ -273,27 +560,42 @@ namespace async
 
         std::size_t count() const
         {
+            if (_source)
+            {
+                return _source->last - _source->first;
+            }
+
             std::size_t result = 0;
-            for (auto &&_ : *this)
+            for ([[maybe_unused]] auto &&_ : *this)
             {
                 ++result;
             }
             return result;
         }
 
-        generator<T> distinct()
+        std::size_t count_if(std::predicate<const T &> auto &&pred) const
         {
-            return [](generator<T> gen_) -> generator<T>
+            std::size_t result = 0;
+            for (auto &&v : *this)
+            {
+                result += pred(v) ? 1 : 0;
+            }
+            return result;
+        }
+
+        template <typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+        generator<T> distinct(std::size_t expected_count = 0, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
+        {
+            return [](generator<T> gen_, flat_hash_set<T, Hash, KeyEqual> seen_) -> generator<T>
             {
-                std::set<T> seen;
                 for (auto &&v : gen_)
                 {
-                    if (seen.insert(v).second)
+                    if (seen_.insert(v).second)
                     {
                         co_yield v;
                     }
                 }
-            }(std::move(*this));
+            }(std::move(*this), flat_hash_set<T, Hash, KeyEqual>(expected_count, hash, equal));
         }
 
         T element_at(std::size_t index) const
@@ -311,176 +613,852 @@ namespace async
             throw std::out_of_range("element_at");
         }
 
-        T first() const
-        {
-            return *begin();
-        }
-
-        T last() const
+        /**
+         * @brief Pairs every element with its zero based position, the element is referenced, not copied.
+         */
+        generator<std::pair<std::size_t, T &>> enumerate()
         {
-            auto it = std::begin(*this);
-            auto end = std::end(*this);
-            while (it != end)
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_) -> generator<std::pair<std::size_t, T &>>
             {
-                ++it;
-                if (it == end)
+                std::size_t index = 0;
+                for (auto &v : gen_)
                 {
-                    return *it;
+                    co_yield std::pair<std::size_t, T &>(index++, v);
                 }
-            }
-
-            throw std::out_of_range("last");
+            }(std::move(*this)), hint);
         }
 
-        generator<T> prepend(const T &value)
+        /**
+         * @brief Sorts more elements than fit in memory_budget bytes by spilling sorted runs to files in tmp_dir.
+         *
+         * The runs are merged lazily while the result is consumed and removed once the generator is destroyed.
+         * Sources that fit in the budget are sorted in memory without touching the disk.
+         */
+        template <typename Compare = std::less<>>
+            requires std::is_trivially_copyable_v<T>
+        generator<T> external_sort(Compare cmp = Compare(), std::size_t memory_budget = std::size_t(64) << 20,
+                                   std::filesystem::path tmp_dir = std::filesystem::temp_directory_path())
         {
-            return [](generator<T> gen_, T value_) -> generator<T>
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_, Compare cmp_, std::size_t budget_, std::filesystem::path tmp_dir_) -> generator<T>
             {
-                co_yield value_;
+                const auto run_capacity = std::max<std::size_t>(budget_ / sizeof(T), 1);
+                _run_files runs(std::move(tmp_dir_));
+                std::vector<T> buffer;
+                buffer.reserve(std::min<std::size_t>(run_capacity, gen_._size_hint.value_or(run_capacity)));
+
                 for (auto &&v : gen_)
                 {
-                    co_yield v;
+                    if (buffer.size() == run_capacity)
+                    {
+                        std::sort(buffer.begin(), buffer.end(), cmp_);
+                        runs.write(buffer);
+                        buffer.clear();
+                    }
+                    buffer.push_back(v);
                 }
-            }(std::move(*this), value);
-        }
 
-        generator<T> prepend(T &&value)
-        {
-            return [](generator<T> gen_, T value_) -> generator<T>
-            {
-                co_yield value_;
-                for (auto &&v : gen_)
+                std::sort(buffer.begin(), buffer.end(), cmp_);
+                if (runs.paths.empty())
                 {
-                    co_yield v;
+                    for (auto &v : buffer)
+                    {
+                        co_yield v;
+                    }
+                    co_return;
                 }
-            }(std::move(*this), std::move(value));
-        }
 
-        generator<T> prepend(generator<T> &&other)
-        {
-            return [](generator<T> gen_, generator<T> other_) -> generator<T>
-            {
-                for (auto &&v : other_)
+                runs.write(buffer);
+                buffer = std::vector<T>();
+
+                // Split the budget between the read buffers of all runs.
+                const auto read_capacity = std::max<std::size_t>(run_capacity / runs.paths.size(), 1);
+                std::vector<generator<T>> readers;
+                readers.reserve(runs.paths.size());
+                for (const auto &path : runs.paths)
                 {
-                    co_yield v;
+                    readers.push_back(_read_run(path, read_capacity));
                 }
-                for (auto &&v : gen_)
+
+                for (auto &&v : _merge(std::move(readers), cmp_))
                 {
                     co_yield v;
                 }
-            }(std::move(*this), std::move(other));
+            }(std::move(*this), std::move(cmp), memory_budget, std::move(tmp_dir)), hint);
         }
 
-        generator<T> range(T from, T to)
+        T first() const
         {
-            for (auto i = from; i <= to; ++i)
-            {
-                co_yield i;
-            }
+            return *begin();
         }
 
-        generator<T> repeat(const T &value, std::size_t count)
+        template <typename KeySelector,
+                  typename Key = std::remove_cvref_t<std::invoke_result_t<KeySelector, const T &>>,
+                  typename Hash = std::hash<Key>,
+                  typename KeyEqual = std::equal_to<Key>>
+        generator<std::pair<Key, std::vector<T>>> group_by(KeySelector &&key_selector, std::size_t expected_groups = 0, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
         {
-            for (int i = 0; i <= count; ++i)
+            return [](generator<T> gen_, auto key_selector_, flat_hash_map<Key, std::vector<T>, Hash, KeyEqual> groups_) -> generator<std::pair<Key, std::vector<T>>>
             {
-                co_yield value;
-            }
+                for (auto &&v : gen_)
+                {
+                    groups_[key_selector_(std::as_const(v))].push_back(std::move(v));
+                }
+
+                for (auto &&group : groups_.extract())
+                {
+                    co_yield std::move(group);
+                }
+            }(std::move(*this), std::forward<KeySelector>(key_selector), flat_hash_map<Key, std::vector<T>, Hash, KeyEqual>(expected_groups, hash, equal));
         }
 
-        generator<T> reverse()
+        /**
+         * @brief Yields one element of each source in turn, sources that end drop out of the rotation.
+         */
+        static generator<T> interleave(std::vector<generator<T>> sources)
         {
-            return [](generator<T> gen_) -> generator<T>
+            std::optional<std::size_t> hint = 0;
+            for (const auto &source : sources)
             {
-                std::vector<T> result;
+                hint = _add_size_hints(hint, source._size_hint);
+            }
 
-                for (auto &&v : gen_)
+            return _with_size_hint([](std::vector<generator<T>> sources_) -> generator<T>
+            {
+                std::vector<iterator> active;
+                active.reserve(sources_.size());
+                for (auto &source : sources_)
                 {
-                    result.push_back(v);
+                    active.push_back(source.begin());
                 }
 
-                auto it = std::rbegin(result);
-                auto end = std::rend(result);
-                while (it != end)
+                while (!active.empty())
                 {
-                    co_yield *it;
-                    ++it;
+                    std::size_t kept = 0;
+                    for (std::size_t i = 0; i < active.size(); ++i)
+                    {
+                        auto &it = active[i];
+                        if (it == std::default_sentinel)
+                        {
+                            continue;
+                        }
+
+                        co_yield std::move(*it);
+                        ++it;
+                        active[kept++] = it;
+                    }
+                    active.resize(kept);
                 }
-            }(std::move(*this));
+            }(std::move(sources)), hint);
         }
 
-        template <typename Selector, typename ResultType = std::invoke_result_t<Selector, T &&>>
-        generator<ResultType> select(Selector &&selector)
+        generator<T> interleave(generator<T> &&other)
         {
-            return [](generator<T> gen_, Selector &&selector_) -> generator<ResultType>
-            {
-                for (auto &&v : gen_)
-                {
-                    co_yield selector_(std::move(v));
-                }
-            }(std::move(*this), std::move(selector));
+            std::vector<generator<T>> sources;
+            sources.push_back(std::move(*this));
+            sources.push_back(std::move(other));
+            return interleave(std::move(sources));
         }
 
-        generator<T> skip(std::size_t count)
+        /**
+         * @brief Inner equi-join, the hash table is built on whichever side turns out to be smaller.
+         *
+         * Both sides are read in lock-step until one of them ends, then the rest of the larger side is streamed
+         * against a table of the smaller one. Results come out in the order of the larger side.
+         */
+        template <typename U,
+                  typename OuterKeySelector,
+                  typename InnerKeySelector,
+                  typename ResultSelector,
+                  typename Key = std::remove_cvref_t<std::invoke_result_t<OuterKeySelector, const T &>>,
+                  typename Result = std::invoke_result_t<ResultSelector, const T &, const U &>>
+        generator<Result> join(generator<U> &&other, OuterKeySelector &&outer_key, InnerKeySelector &&inner_key, ResultSelector &&result_selector)
         {
-            return [](generator<T> gen_, std::size_t count_) -> generator<T>
+            return [](generator<T> outer_, generator<U> inner_, auto outer_key_, auto inner_key_, auto result_selector_) -> generator<Result>
             {
-                for (auto &&v : gen_)
+                static constexpr auto end_of_chain = std::numeric_limits<std::uint32_t>::max();
+
+                // Maps each key to the first and last row having it, equal keys are chained through next.
+                auto build = [](const auto &rows, auto &key_selector, std::vector<std::uint32_t> &next)
                 {
-                    if (count_ > 0)
+                    // Rows are indexed with 32 bits to keep the chains small, the largest index marks their end.
+                    if (rows.size() >= end_of_chain)
                     {
-                        --count_;
+                        throw std::length_error("join: the smaller side has too many rows");
                     }
-                    else
+
+                    flat_hash_map<Key, std::pair<std::uint32_t, std::uint32_t>> table(rows.size());
+                    next.assign(rows.size(), end_of_chain);
+                    for (std::uint32_t i = 0; i < rows.size(); ++i)
+                    {
+                        auto [it, inserted] = table.try_emplace(key_selector(rows[i]), i, i);
+                        if (!inserted)
+                        {
+                            next[it->second.second] = i;
+                            it->second.second = i;
+                        }
+                    }
+                    return table;
+                };
+
+                auto rest = []<typename V>(std::vector<V> buffered_, [[maybe_unused]] generator<V> gen_, typename generator<V>::iterator it_) -> generator<V>
+                {
+                    for (auto &v : buffered_)
                     {
                         co_yield std::move(v);
                     }
+                    for (; it_ != std::default_sentinel; ++it_)
+                    {
+                        co_yield std::move(*it_);
+                    }
+                };
+
+                std::vector<T> outer_rows;
+                std::vector<U> inner_rows;
+                auto outer_it = outer_.begin();
+                auto inner_it = inner_.begin();
+                while (outer_it != std::default_sentinel && inner_it != std::default_sentinel)
+                {
+                    outer_rows.push_back(std::move(*outer_it));
+                    inner_rows.push_back(std::move(*inner_it));
+                    ++outer_it;
+                    ++inner_it;
                 }
-            }(std::move(*this), count);
-        }
 
-        generator<T> skip_while(std::invocable<const T &> auto &&predicate)
-        {
-            return [](generator<T> gen_, std::invocable<const T &> auto &&predicate_) -> generator<T>
-            {
-                bool skip = true;
-                for (auto &&v : gen_)
+                std::vector<std::uint32_t> next;
+                if (inner_it == std::default_sentinel)
                 {
-                    if (skip && predicate_(v))
+                    auto table = build(inner_rows, inner_key_, next);
+                    for (auto &&row : rest(std::move(outer_rows), std::move(outer_), outer_it))
                     {
-                        continue;
+                        auto match = table.find(outer_key_(std::as_const(row)));
+                        if (match == table.end())
+                        {
+                            continue;
+                        }
+
+                        for (auto i = match->second.first; i != end_of_chain; i = next[i])
+                        {
+                            co_yield result_selector_(std::as_const(row), std::as_const(inner_rows[i]));
+                        }
                     }
-                    skip = false;
-                    co_yield std::move(v);
                 }
-            }(std::move(*this), predicate);
-        }
-
-        generator<T> where(std::invocable<const T &> auto &&predicate)
-        {
-            return [](generator<T> gen_, auto &&predicate_) -> generator<T>
-            {
-                for (auto &&v : gen_)
+                else
                 {
-                    if (predicate_(v))
+                    auto table = build(outer_rows, outer_key_, next);
+                    for (auto &&row : rest(std::move(inner_rows), std::move(inner_), inner_it))
                     {
-                        co_yield std::move(v);
+                        auto match = table.find(inner_key_(std::as_const(row)));
+                        if (match == table.end())
+                        {
+                            continue;
+                        }
+
+                        for (auto i = match->second.first; i != end_of_chain; i = next[i])
+                        {
+                            co_yield result_selector_(std::as_const(outer_rows[i]), std::as_const(row));
+                        }
                     }
                 }
-            }(std::move(*this), predicate);
+            }(std::move(*this), std::move(other), std::forward<OuterKeySelector>(outer_key), std::forward<InnerKeySelector>(inner_key), std::forward<ResultSelector>(result_selector));
         }
 
-        template <typename ExecutionMode = std::execution::sequenced_policy>
-        void for_each(std::invocable<T &&> auto &&func)
+        T last() const
         {
-            if constexpr (std::is_same_v<ExecutionMode, std::execution::parallel_unsequenced_policy>)
+            if (_source)
             {
-                std::vector<task<void>> tasks;
-                for (auto &&v : *this)
+                if (_source->first == _source->last)
                 {
-                    tasks.emplace_back(std::move(task<void>::run(func, v)));
+                    throw std::out_of_range("last");
                 }
+                return *(_source->last - 1);
+            }
 
-                task<void>::when_all(tasks).wait();
+            // The yielded element is gone once the coroutine moves on, so each one is moved out before resuming it.
+            std::optional<T> result;
+            for (auto &&v : *this)
+            {
+                result.emplace(std::move(v));
+            }
+
+            if (!result)
+            {
+                throw std::out_of_range("last");
+            }
+            return std::move(*result);
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        T max()
+        {
+            return batch().max();
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        T min()
+        {
+            return batch().min();
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        std::pair<T, T> min_max()
+        {
+            return batch().min_max();
+        }
+
+        /**
+         * @brief Merges already sorted generators into one sorted generator, ties keep the order of the sources.
+         */
+        template <typename Compare = std::less<>>
+        static generator<T> merge(std::vector<generator<T>> sources, Compare cmp = Compare())
+        {
+            std::optional<std::size_t> hint = 0;
+            for (const auto &source : sources)
+            {
+                hint = _add_size_hints(hint, source._size_hint);
+            }
+            return _with_size_hint(_merge(std::move(sources), std::move(cmp)), hint);
+        }
+
+        template <typename Compare = std::less<>>
+        generator<T> merge(generator<T> &&other, Compare cmp = Compare())
+        {
+            std::vector<generator<T>> sources;
+            sources.push_back(std::move(*this));
+            sources.push_back(std::move(other));
+            return merge(std::move(sources), std::move(cmp));
+        }
+
+        /**
+         * @brief Sorts the elements by the key selected from each of them, equal keys keep their order.
+         *
+         * Inputs of at least parallel_threshold elements are sorted with std::execution::par.
+         */
+        template <typename KeySelector, typename Compare = std::less<>>
+        generator<T> order_by(KeySelector &&key_selector, Compare cmp = Compare(), std::size_t parallel_threshold = 1 << 16)
+        {
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_, auto key_selector_, Compare cmp_, std::size_t parallel_threshold_) -> generator<T>
+            {
+                auto values = gen_.to_vector();
+                auto before = [&](const T &a, const T &b)
+                {
+                    return cmp_(key_selector_(a), key_selector_(b));
+                };
+
+                if (values.size() >= parallel_threshold_)
+                {
+                    std::stable_sort(std::execution::par, values.begin(), values.end(), before);
+                }
+                else
+                {
+                    std::stable_sort(values.begin(), values.end(), before);
+                }
+
+                for (auto &v : values)
+                {
+                    co_yield std::move(v);
+                }
+            }(std::move(*this), std::forward<KeySelector>(key_selector), std::move(cmp), parallel_threshold), hint);
+        }
+
+        /**
+         * @brief Drives this generator on a worker thread, buffering up to depth elements ahead of the consumer.
+         *
+         * Exceptions thrown upstream are rethrown to the consumer once the elements before them are consumed.
+         */
+        generator<T> prefetch(std::size_t depth = 64)
+        {
+            if (_source)
+            {
+                return std::move(*this);
+            }
+
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_, std::size_t depth_) -> generator<T>
+            {
+                spsc_ring<T> ring(depth_);
+                std::exception_ptr exception;
+                std::thread worker([&ring, &exception](generator<T> upstream)
+                {
+                    try
+                    {
+                        for (auto &&v : upstream)
+                        {
+                            if (!ring.push(std::move(v)))
+                            {
+                                break;
+                            }
+                        }
+                    }
+                    catch (...)
+                    {
+                        exception = std::current_exception();
+                    }
+                    ring.close();
+                }, std::move(gen_));
+
+                // Stops and joins the worker even when the consumer abandons this generator early.
+                struct joiner
+                {
+                    spsc_ring<T> &ring;
+                    std::thread &worker;
+
+                    ~joiner()
+                    {
+                        ring.close();
+                        worker.join();
+                    }
+                } join{ring, worker};
+
+                while (auto item = ring.pop())
+                {
+                    co_yield std::move(*item);
+                }
+
+                if (exception)
+                {
+                    std::rethrow_exception(exception);
+                }
+            }(std::move(*this), depth), hint);
+        }
+
+        generator<T> prepend(const T &value)
+        {
+            auto hint = _add_size_hints(_size_hint, 1);
+            return _with_size_hint([](generator<T> gen_, T value_) -> generator<T>
+            {
+                co_yield std::move(value_);
+                co_yield elements_of(std::move(gen_));
+            }(std::move(*this), value), hint);
+        }
+
+        generator<T> prepend(T &&value)
+        {
+            auto hint = _add_size_hints(_size_hint, 1);
+            return _with_size_hint([](generator<T> gen_, T value_) -> generator<T>
+            {
+                co_yield std::move(value_);
+                co_yield elements_of(std::move(gen_));
+            }(std::move(*this), std::move(value)), hint);
+        }
+
+        generator<T> prepend(generator<T> &&other)
+        {
+            auto hint = _add_size_hints(_size_hint, other._size_hint);
+            return _with_size_hint([](generator<T> gen_, generator<T> other_) -> generator<T>
+            {
+                co_yield elements_of(std::move(other_));
+                co_yield elements_of(std::move(gen_));
+            }(std::move(*this), std::move(other)), hint);
+        }
+
+        static generator<T> range(T from, T to)
+        {
+            auto hint = from <= to ? std::optional<std::size_t>(static_cast<std::size_t>(to - from) + 1) : std::optional<std::size_t>(0);
+            return _with_size_hint([](T from_, T to_) -> generator<T>
+            {
+                for (auto i = from_; i <= to_; ++i)
+                {
+                    co_yield i;
+                }
+            }(from, to), hint);
+        }
+
+        static generator<T> repeat(const T &value, std::size_t count)
+        {
+            return _with_size_hint([](T value_, std::size_t count_) -> generator<T>
+            {
+                for (std::size_t i = 0; i < count_; ++i)
+                {
+                    co_yield value_;
+                }
+            }(value, count), count);
+        }
+
+        generator<T> reverse()
+        {
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_) -> generator<T>
+            {
+                std::vector<T> result = gen_.to_vector();
+
+                auto it = std::rbegin(result);
+                auto end = std::rend(result);
+                while (it != end)
+                {
+                    co_yield std::move(*it);
+                    ++it;
+                }
+            }(std::move(*this)), hint);
+        }
+
+        /**
+         * @brief Yields the maximum of every window of size consecutive elements.
+         */
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        generator<T> rolling_max(std::size_t size)
+        {
+            return _rolling_extreme(size, std::greater<T>(), "rolling_max");
+        }
+
+        /**
+         * @brief Yields the average of every window of size consecutive elements.
+         */
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        generator<double> rolling_mean(std::size_t size)
+        {
+            return rolling_sum(size).select([size](sum_t<T> sum)
+                                            { return static_cast<double>(sum) / size; });
+        }
+
+        /**
+         * @brief Yields the minimum of every window of size consecutive elements.
+         */
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        generator<T> rolling_min(std::size_t size)
+        {
+            return _rolling_extreme(size, std::less<T>(), "rolling_min");
+        }
+
+        /**
+         * @brief Yields the sum of every window of size consecutive elements.
+         *
+         * Each step adds the entering and subtracts the leaving element, floating point sums are compensated.
+         */
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        generator<sum_t<T>> rolling_sum(std::size_t size)
+        {
+            if (size == 0)
+            {
+                throw std::invalid_argument("rolling_sum");
+            }
+
+            auto hint = _window_count(_size_hint, size, 1);
+            return _with_size_hint([](generator<T> gen_, std::size_t size_) -> generator<sum_t<T>>
+            {
+                std::vector<T> ring(size_);
+                std::size_t index = 0;
+                sum_t<T> sum = 0;
+                sum_t<T> compensation = 0;
+                for (auto v : gen_)
+                {
+                    auto &slot = ring[index % size_];
+                    if constexpr (std::is_floating_point_v<T>)
+                    {
+                        simd::detail::kahan_add(sum, compensation, static_cast<sum_t<T>>(v));
+                        if (index >= size_)
+                        {
+                            simd::detail::kahan_add(sum, compensation, -static_cast<sum_t<T>>(slot));
+                        }
+                    }
+                    else
+                    {
+                        // Wraps around and back for unsigned sums, the window total itself is always in range.
+                        sum += static_cast<sum_t<T>>(v);
+                        if (index >= size_)
+                        {
+                            sum -= static_cast<sum_t<T>>(slot);
+                        }
+                    }
+                    slot = v;
+
+                    if (++index >= size_)
+                    {
+                        co_yield sum - compensation;
+                    }
+                }
+            }(std::move(*this), size), hint);
+        }
+
+        template <typename Selector, typename ResultType = std::invoke_result_t<Selector, T &&>>
+        generator<ResultType> select(Selector &&selector)
+        {
+            auto hint = _size_hint;
+            return _with_size_hint([](generator<T> gen_, auto selector_) -> generator<ResultType>
+            {
+                for (auto &&v : gen_)
+                {
+                    co_yield selector_(std::move(v));
+                }
+            }(std::move(*this), std::forward<Selector>(selector)), hint);
+        }
+
+        generator<T> skip(std::size_t count)
+        {
+            auto hint = _size_hint ? std::optional<std::size_t>(*_size_hint - std::min(*_size_hint, count)) : std::nullopt;
+            return _with_size_hint([](generator<T> gen_, std::size_t count_) -> generator<T>
+            {
+                for (auto &&v : gen_)
+                {
+                    if (count_ > 0)
+                    {
+                        --count_;
+                    }
+                    else
+                    {
+                        co_yield std::move(v);
+                    }
+                }
+            }(std::move(*this), count), hint);
+        }
+
+        generator<T> skip_while(std::invocable<const T &> auto &&predicate)
+        {
+            return [](generator<T> gen_, auto predicate_) -> generator<T>
+            {
+                bool skip = true;
+                for (auto &&v : gen_)
+                {
+                    if (skip && predicate_(v))
+                    {
+                        continue;
+                    }
+                    skip = false;
+                    co_yield std::move(v);
+                }
+            }(std::move(*this), std::forward<decltype(predicate)>(predicate));
+        }
+
+        /**
+         * @brief Yields the first element and then every stride-th element after it.
+         */
+        generator<T> step(std::size_t stride)
+        {
+            if (stride == 0)
+            {
+                throw std::invalid_argument("step");
+            }
+
+            auto hint = _size_hint ? std::optional<std::size_t>((*_size_hint + stride - 1) / stride) : std::nullopt;
+            return _with_size_hint([](generator<T> gen_, std::size_t stride_) -> generator<T>
+            {
+                std::size_t i = 0;
+                for (auto &&v : gen_)
+                {
+                    if (i++ % stride_ == 0)
+                    {
+                        co_yield std::move(v);
+                    }
+                }
+            }(std::move(*this), stride), hint);
+        }
+
+        template <typename U = T>
+            requires std::is_arithmetic_v<U>
+        sum_t<T> sum(summation mode = summation::pairwise)
+        {
+            return batch().sum(mode);
+        }
+
+        /**
+         * @brief Yields at most count elements, this generator is not resumed again once they have been yielded.
+         */
+        generator<T> take(std::size_t count)
+        {
+            auto hint = _size_hint ? std::optional<std::size_t>(std::min(*_size_hint, count)) : std::nullopt;
+            return _with_size_hint([](generator<T> gen_, std::size_t count_) -> generator<T>
+            {
+                if (count_ == 0)
+                {
+                    co_return;
+                }
+
+                for (auto &&v : gen_)
+                {
+                    co_yield std::move(v);
+                    if (--count_ == 0)
+                    {
+                        break;
+                    }
+                }
+            }(std::move(*this), count), hint);
+        }
+
+        generator<T> take_while(std::invocable<const T &> auto &&predicate)
+        {
+            return [](generator<T> gen_, auto predicate_) -> generator<T>
+            {
+                for (auto &&v : gen_)
+                {
+                    if (!predicate_(std::as_const(v)))
+                    {
+                        break;
+                    }
+                    co_yield std::move(v);
+                }
+            }(std::move(*this), std::forward<decltype(predicate)>(predicate));
+        }
+
+        /**
+         * @brief Yields the first k elements of the sequence sorted by cmp, in that order.
+         *
+         * Only k elements are kept at any time, the default comparison yields the k largest elements.
+         */
+        template <typename Compare = std::greater<>>
+        generator<T> top_k(std::size_t k, Compare cmp = Compare())
+        {
+            auto hint = _size_hint ? std::optional<std::size_t>(std::min(*_size_hint, k)) : std::optional<std::size_t>();
+            return _with_size_hint([](generator<T> gen_, std::size_t k_, Compare cmp_) -> generator<T>
+            {
+                if (k_ == 0)
+                {
+                    co_return;
+                }
+
+                // The heap keeps the element sorting last on top, so it is the one replaced by better candidates.
+                std::vector<T> heap;
+                heap.reserve(std::min(k_, gen_._size_hint.value_or(k_)));
+                for (auto &&v : gen_)
+                {
+                    if (heap.size() < k_)
+                    {
+                        heap.push_back(std::move(v));
+                        std::push_heap(heap.begin(), heap.end(), cmp_);
+                    }
+                    else if (cmp_(std::as_const(v), heap.front()))
+                    {
+                        std::pop_heap(heap.begin(), heap.end(), cmp_);
+                        heap.back() = std::move(v);
+                        std::push_heap(heap.begin(), heap.end(), cmp_);
+                    }
+                }
+
+                std::sort_heap(heap.begin(), heap.end(), cmp_);
+                for (auto &v : heap)
+                {
+                    co_yield std::move(v);
+                }
+            }(std::move(*this), k, std::move(cmp)), hint);
+        }
+
+        generator<T> where(std::invocable<const T &> auto &&predicate)
+        {
+            return [](generator<T> gen_, auto predicate_) -> generator<T>
+            {
+                for (auto &&v : gen_)
+                {
+                    if (predicate_(v))
+                    {
+                        co_yield std::move(v);
+                    }
+                }
+            }(std::move(*this), std::forward<decltype(predicate)>(predicate));
+        }
+
+        /**
+         * @brief Yields every window of size consecutive elements, a new window starts every step elements.
+         *
+         * Windows are views into one reusable buffer and are only valid until the generator is resumed.
+         * Trailing elements that do not fill a whole window are not yielded.
+         */
+        generator<std::span<const T>> window(std::size_t size, std::size_t step = 1)
+        {
+            if (size == 0 || step == 0)
+            {
+                throw std::invalid_argument("window");
+            }
+
+            auto hint = _window_count(_size_hint, size, step);
+            return _with_size_hint([](generator<T> gen_, std::size_t size_, std::size_t step_) -> generator<std::span<const T>>
+            {
+                // Windows are kept contiguous in a linear buffer; once it is full the live window is moved back
+                // to the front, which happens at most once every size + 1 elements.
+                const auto capacity = std::max(2 * size_, size_ + 1);
+                std::vector<T> buffer;
+                buffer.reserve(capacity);
+                std::size_t first = 0;
+                std::size_t skip = 0;
+                for (auto &&v : gen_)
+                {
+                    if (skip > 0)
+                    {
+                        --skip;
+                        continue;
+                    }
+
+                    if (buffer.size() == capacity)
+                    {
+                        buffer.erase(buffer.begin(), buffer.begin() + first);
+                        first = 0;
+                    }
+                    buffer.push_back(std::move(v));
+
+                    if (buffer.size() - first == size_)
+                    {
+                        co_yield std::span<const T>(buffer.data() + first, size_);
+                        if (step_ < size_)
+                        {
+                            first += step_;
+                        }
+                        else
+                        {
+                            first = buffer.size();
+                            skip = step_ - size_;
+                        }
+                    }
+                }
+            }(std::move(*this), size, step), hint);
+        }
+
+        /**
+         * @brief Advances this and the other generators in lock-step, yielding tuples of references to their elements.
+         *
+         * Sources are advanced left to right and zipping stops at the first one that ends, the sources after it
+         * are not resumed again. Sources before it have already been resumed for the next tuple.
+         */
+        template <typename... Us>
+        generator<std::tuple<T &, Us &...>> zip(generator<Us> &&...others)
+        {
+            std::optional<std::size_t> hint = _size_hint;
+            ((hint = hint && others._size_hint ? std::optional<std::size_t>(std::min(*hint, *others._size_hint)) : std::nullopt), ...);
+            return _with_size_hint([](generator<T> gen_, generator<Us>... others_) -> generator<std::tuple<T &, Us &...>>
+            {
+                // Both folds short-circuit, so no source is started or resumed after one ended.
+                auto sources = std::tie(gen_, others_...);
+                std::tuple<typename generator<T>::iterator, typename generator<Us>::iterator...> its;
+                const bool started = [&]<std::size_t... I>(std::index_sequence<I...>)
+                {
+                    return ((std::get<I>(its) = std::get<I>(sources).begin(), std::get<I>(its) != std::default_sentinel) && ...);
+                }(std::index_sequence_for<T, Us...>());
+                auto advance = [&]
+                {
+                    return std::apply([](auto &...it)
+                                      { return ((++it, it != std::default_sentinel) && ...); }, its);
+                };
+
+                if (!started)
+                {
+                    co_return;
+                }
+                do
+                {
+                    co_yield std::apply([](auto &...it)
+                                        { return std::tuple<T &, Us &...>(*it...); }, its);
+                } while (advance());
+            }(std::move(*this), std::move(others)...), hint);
+        }
+
+        template <typename ExecutionMode = std::execution::sequenced_policy>
+        void for_each(std::invocable<T &&> auto &&func)
+        {
+            if constexpr (std::is_same_v<ExecutionMode, std::execution::parallel_unsequenced_policy>)
+            {
+                std::vector<task<void>> tasks;
+                for (auto &&v : *this)
+                {
+                    tasks.emplace_back(std::move(task<void>::run(func, v)));
+                }
+
+                task<void>::when_all(tasks).wait();
             }
             else if constexpr (std::is_same_v<ExecutionMode, std::execution::sequenced_policy>)
             {
@@ -491,13 +1469,29 @@ namespace async
             }
             else
             {
-                static_assert(false, "Invalid execution mode");
+                static_assert(sizeof(ExecutionMode) == 0, "Invalid execution mode");
             }
         }
 
         std::vector<T> to_vector()
         {
+            if (_source)
+            {
+                if constexpr (std::copy_constructible<T>)
+                {
+                    if (_source->borrowed)
+                    {
+                        return std::vector<T>(_source->first, _source->last);
+                    }
+                }
+                return std::vector<T>(std::make_move_iterator(_source->data()), std::make_move_iterator(_source->data() + (_source->last - _source->first)));
+            }
+
             std::vector<T> result;
+            if (_size_hint)
+            {
+                result.reserve(*_size_hint);
+            }
             for (auto &&v : *this)
             {
                 result.push_back(std::move(v));
@@ -514,6 +1508,274 @@ namespace async
         }
 
     private:
+        template <typename U>
+        friend class generator;
+
+        // A contiguous range walked without a coroutine, borrowed elements are copied out one at a time
+        // so that consumers moving from *it never modify the caller's range.
+        struct contiguous_source
+        {
+            std::shared_ptr<void> owner;
+            const T *first = nullptr;
+            const T *last = nullptr;
+            bool borrowed = false;
+            std::optional<T> current;
+
+            T *data() const noexcept
+            {
+                // Only used for owned ranges, which were never const.
+                return const_cast<T *>(first);
+            }
+
+            T &get() noexcept
+            {
+                return borrowed ? *current : *data();
+            }
+
+            void load()
+            {
+                if constexpr (std::copy_constructible<T>)
+                {
+                    if (borrowed && first != last)
+                    {
+                        current = *first;
+                    }
+                }
+            }
+
+            void advance()
+            {
+                ++first;
+                load();
+            }
+        };
+
         std::coroutine_handle<promise_type> _handle;
+        std::unique_ptr<contiguous_source> _source;
+        std::optional<std::size_t> _size_hint;
+
+        static generator<T> _as_coroutine(generator<T> &&gen)
+        {
+            if (!gen._source)
+            {
+                return std::move(gen);
+            }
+
+            return [](generator<T> gen_) -> generator<T>
+            {
+                for (auto &&v : gen_)
+                {
+                    co_yield std::move(v);
+                }
+            }(std::move(gen));
+        }
+
+        template <typename U>
+        static generator<U> _with_size_hint(generator<U> &&gen, std::optional<std::size_t> hint) noexcept
+        {
+            gen._size_hint = hint;
+            return std::move(gen);
+        }
+
+        static std::optional<std::size_t> _add_size_hints(std::optional<std::size_t> a, std::optional<std::size_t> b) noexcept
+        {
+            if (!a || !b)
+            {
+                return std::nullopt;
+            }
+            return *a + *b;
+        }
+
+        /**
+         * @brief Sorted runs written by external_sort, the files are removed on destruction.
+         */
+        struct _run_files
+        {
+            std::filesystem::path directory;
+            std::vector<std::filesystem::path> paths;
+
+            _run_files(std::filesystem::path dir)
+                : directory(std::move(dir))
+            {
+            }
+
+            _run_files(const _run_files &) = delete;
+
+            _run_files &operator=(const _run_files &) = delete;
+
+            void write(const std::vector<T> &values)
+            {
+                static std::atomic<std::uint64_t> counter = 0;
+                auto name = "asyncpp-sort-" + std::to_string(std::random_device()()) + "-" + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+                paths.push_back(directory / name);
+
+                std::ofstream file(paths.back(), std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+                if (!file)
+                {
+                    throw std::runtime_error("external_sort: failed to write " + paths.back().string());
+                }
+            }
+
+            ~_run_files()
+            {
+                for (const auto &path : paths)
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(path, ec);
+                }
+            }
+        };
+
+        static generator<T> _read_run(std::filesystem::path path, std::size_t capacity)
+        {
+            std::ifstream file(path, std::ios::binary);
+            if (!file)
+            {
+                throw std::runtime_error("external_sort: failed to open " + path.string());
+            }
+
+            std::vector<T> buffer(capacity);
+            while (file)
+            {
+                file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(capacity * sizeof(T)));
+                const auto count = static_cast<std::size_t>(file.gcount()) / sizeof(T);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    co_yield buffer[i];
+                }
+            }
+        }
+
+        static std::optional<std::size_t> _window_count(std::optional<std::size_t> count, std::size_t size, std::size_t step)
+        {
+            if (!count)
+            {
+                return std::nullopt;
+            }
+            return *count < size ? 0 : (*count - size) / step + 1;
+        }
+
+        template <typename Compare>
+        generator<T> _rolling_extreme(std::size_t size, Compare better, const char *name)
+        {
+            if (size == 0)
+            {
+                throw std::invalid_argument(name);
+            }
+
+            auto hint = _window_count(_size_hint, size, 1);
+            return _with_size_hint([](generator<T> gen_, std::size_t size_, Compare better_) -> generator<T>
+            {
+                // Monotonic deque in a fixed ring: candidates are ordered by position and by value, so the
+                // front is the extreme of the window and every element is pushed and popped at most once.
+                struct candidate
+                {
+                    std::size_t index;
+                    T value;
+                };
+
+                std::vector<candidate> ring(size_);
+                std::size_t head = 0;
+                std::size_t count = 0;
+                std::size_t index = 0;
+                for (auto v : gen_)
+                {
+                    while (count > 0 && !better_(ring[(head + count - 1) % size_].value, v))
+                    {
+                        --count;
+                    }
+                    if (count > 0 && ring[head].index + size_ <= index)
+                    {
+                        head = (head + 1) % size_;
+                        --count;
+                    }
+                    ring[(head + count) % size_] = candidate{index, v};
+                    ++count;
+
+                    if (++index >= size_)
+                    {
+                        co_yield ring[head].value;
+                    }
+                }
+            }(std::move(*this), size, std::move(better)), hint);
+        }
+
+        template <typename Compare>
+        static generator<T> _merge(std::vector<generator<T>> sources, Compare cmp)
+        {
+            struct head
+            {
+                iterator it;
+                std::size_t source;
+            };
+
+            // std heap algorithms keep the largest element on top, so order the heads the other way around.
+            auto after = [&cmp](const head &a, const head &b)
+            {
+                if (cmp(*b.it, *a.it))
+                {
+                    return true;
+                }
+                return !cmp(*a.it, *b.it) && b.source < a.source;
+            };
+
+            std::vector<head> heads;
+            heads.reserve(sources.size());
+            for (std::size_t i = 0; i < sources.size(); ++i)
+            {
+                auto it = sources[i].begin();
+                if (it != std::default_sentinel)
+                {
+                    heads.push_back(head{it, i});
+                }
+            }
+
+            std::make_heap(heads.begin(), heads.end(), after);
+            while (!heads.empty())
+            {
+                std::pop_heap(heads.begin(), heads.end(), after);
+                auto &smallest = heads.back();
+                co_yield std::move(*smallest.it);
+
+                ++smallest.it;
+                if (smallest.it == std::default_sentinel)
+                {
+                    heads.pop_back();
+                }
+                else
+                {
+                    std::push_heap(heads.begin(), heads.end(), after);
+                }
+            }
+        }
     };
-}
\ No newline at end of file
+
+    template <typename T, typename... Us>
+    generator<std::tuple<T &, Us &...>> zip(generator<T> &&first, generator<Us> &&...others)
+    {
+        return first.zip(std::move(others)...);
+    }
+
+    /**
+     * @brief Range adaptor turning the end of a std::ranges pipeline into a generator.
+     */
+    struct to_generator_adaptor
+    {
+        template <std::ranges::input_range Range>
+        auto operator()(Range &&range) const
+        {
+            return generator<std::ranges::range_value_t<Range>>(std::forward<Range>(range));
+        }
+
+        template <std::ranges::input_range Range>
+        friend auto operator|(Range &&range, const to_generator_adaptor &adaptor)
+        {
+            return adaptor(std::forward<Range>(range));
+        }
+    };
+
+    inline constexpr to_generator_adaptor to_generator;
+}
+
+#include "batch_generator.hpp"
\ No newline at end of file
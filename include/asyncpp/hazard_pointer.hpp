@@ -0,0 +1,284 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace async
+{
+    namespace detail
+    {
+        struct hazard_record
+        {
+            std::atomic<const void *> pointer{nullptr};
+            std::atomic<bool> active{false};
+            hazard_record *next = nullptr;
+        };
+
+        struct retired_pointer
+        {
+            void *pointer;
+            void (*destroy)(void *);
+        };
+
+        /**
+         * @brief Process wide list of hazard records plus the retired pointers of threads that already exited.
+         *
+         * Records are never freed while the process runs, released ones are reused by other threads.
+         */
+        class hazard_domain
+        {
+        public:
+            static hazard_domain &instance()
+            {
+                static hazard_domain domain;
+                return domain;
+            }
+
+            hazard_record *acquire()
+            {
+                for (auto record = _records.load(std::memory_order_acquire); record; record = record->next)
+                {
+                    bool expected = false;
+                    if (!record->active.load(std::memory_order_relaxed) &&
+                        record->active.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                    {
+                        return record;
+                    }
+                }
+
+                auto record = new hazard_record;
+                record->active.store(true, std::memory_order_relaxed);
+                auto head = _records.load(std::memory_order_relaxed);
+                do
+                {
+                    record->next = head;
+                } while (!_records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+                _record_count.fetch_add(1, std::memory_order_relaxed);
+                return record;
+            }
+
+            void release(hazard_record *record) noexcept
+            {
+                record->pointer.store(nullptr, std::memory_order_release);
+                record->active.store(false, std::memory_order_release);
+            }
+
+            std::size_t record_count() const noexcept
+            {
+                return _record_count.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Destroys every retired pointer no hazard record protects, the others stay in retired.
+             */
+            void reclaim(std::vector<retired_pointer> &retired)
+            {
+                {
+                    std::lock_guard lock(_orphans_mutex);
+                    retired.insert(retired.end(), _orphans.begin(), _orphans.end());
+                    _orphans.clear();
+                }
+
+                // Pairs with the fence in hazard_pointer::protect, a pointer published before it is seen here.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                std::vector<const void *> hazards;
+                for (auto record = _records.load(std::memory_order_acquire); record; record = record->next)
+                {
+                    if (auto pointer = record->pointer.load(std::memory_order_acquire))
+                    {
+                        hazards.push_back(pointer);
+                    }
+                }
+                std::sort(hazards.begin(), hazards.end());
+
+                auto protected_end = std::partition(retired.begin(), retired.end(), [&](const retired_pointer &r)
+                                                    { return std::binary_search(hazards.begin(), hazards.end(), static_cast<const void *>(r.pointer)); });
+                std::vector<retired_pointer> reclaimable(protected_end, retired.end());
+                retired.erase(protected_end, retired.end());
+                for (const auto &r : reclaimable)
+                {
+                    r.destroy(r.pointer);
+                }
+            }
+
+            void orphan(std::vector<retired_pointer> &&retired)
+            {
+                std::lock_guard lock(_orphans_mutex);
+                _orphans.insert(_orphans.end(), retired.begin(), retired.end());
+            }
+
+            ~hazard_domain()
+            {
+                for (const auto &r : _orphans)
+                {
+                    r.destroy(r.pointer);
+                }
+
+                auto record = _records.load(std::memory_order_acquire);
+                while (record)
+                {
+                    delete std::exchange(record, record->next);
+                }
+            }
+
+        private:
+            std::atomic<hazard_record *> _records = nullptr;
+            std::atomic<std::size_t> _record_count = 0;
+            std::mutex _orphans_mutex;
+            std::vector<retired_pointer> _orphans;
+
+            hazard_domain() = default;
+        };
+
+        /**
+         * @brief Caches released records and collects retired pointers per thread, so neither touches shared state.
+         */
+        class hazard_thread_state
+        {
+        public:
+            static hazard_thread_state &instance()
+            {
+                thread_local hazard_thread_state state;
+                return state;
+            }
+
+            hazard_record *acquire()
+            {
+                if (_free.empty())
+                {
+                    return _domain.acquire();
+                }
+
+                auto record = _free.back();
+                _free.pop_back();
+                return record;
+            }
+
+            void release(hazard_record *record) noexcept
+            {
+                record->pointer.store(nullptr, std::memory_order_release);
+                if (_free.size() < _max_cached_records)
+                {
+                    _free.push_back(record);
+                }
+                else
+                {
+                    _domain.release(record);
+                }
+            }
+
+            void retire(retired_pointer pointer)
+            {
+                _retired.push_back(pointer);
+                // Scanning once per O(records) retirements keeps reclamation amortized constant per pointer.
+                if (_retired.size() >= std::max<std::size_t>(_min_scan_threshold, 2 * _domain.record_count()))
+                {
+                    _domain.reclaim(_retired);
+                }
+            }
+
+            ~hazard_thread_state()
+            {
+                for (auto record : _free)
+                {
+                    _domain.release(record);
+                }
+
+                _domain.reclaim(_retired);
+                if (!_retired.empty())
+                {
+                    _domain.orphan(std::move(_retired));
+                }
+            }
+
+        private:
+            static constexpr std::size_t _max_cached_records = 8;
+
+            static constexpr std::size_t _min_scan_threshold = 64;
+
+            hazard_domain &_domain = hazard_domain::instance();
+            std::vector<hazard_record *> _free;
+            std::vector<retired_pointer> _retired;
+
+            hazard_thread_state()
+            {
+                _free.reserve(_max_cached_records);
+            }
+        };
+    }
+
+    /**
+     * @brief Owns one hazard record, a pointer protected through it is not destroyed by retire until reset.
+     */
+    class hazard_pointer
+    {
+    public:
+        hazard_pointer()
+            : _record(detail::hazard_thread_state::instance().acquire())
+        {
+        }
+
+        hazard_pointer(const hazard_pointer &) = delete;
+
+        hazard_pointer &operator=(const hazard_pointer &) = delete;
+
+        /**
+         * @brief Loads source until the protected value is still current, the result is safe to dereference.
+         */
+        template <typename T>
+        T *protect(const std::atomic<T *> &source) noexcept
+        {
+            auto pointer = source.load(std::memory_order_relaxed);
+            while (true)
+            {
+                // Release orders this thread's reads of the previously protected pointer before a reclaimer sees it dropped.
+                _record->pointer.store(pointer, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto current = source.load(std::memory_order_acquire);
+                if (current == pointer)
+                {
+                    return pointer;
+                }
+                pointer = current;
+            }
+        }
+
+        void reset() noexcept
+        {
+            _record->pointer.store(nullptr, std::memory_order_release);
+        }
+
+        friend void swap(hazard_pointer &a, hazard_pointer &b) noexcept
+        {
+            std::swap(a._record, b._record);
+        }
+
+        ~hazard_pointer()
+        {
+            detail::hazard_thread_state::instance().release(_record);
+        }
+
+    private:
+        detail::hazard_record *_record;
+    };
+
+    /**
+     * @brief Hands pointer to Reclaim, deleting it by default, once no hazard_pointer protects it.
+     *
+     * pointer must already be unreachable for new readers. Reclaim is stateless so it fits the retired list
+     * next to the pointer, anything it needs has to be reachable from the pointer itself.
+     */
+    template <typename T, typename Reclaim = std::default_delete<T>>
+        requires std::is_empty_v<Reclaim> && std::default_initializable<Reclaim>
+    void retire(T *pointer, Reclaim = {})
+    {
+        detail::hazard_thread_state::instance().retire(detail::retired_pointer{pointer, [](void *p)
+                                                                               { Reclaim{}(static_cast<T *>(p)); }});
+    }
+}
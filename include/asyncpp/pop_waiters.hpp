@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "cache_line.hpp"
+#include "resume_deferral.hpp"
+
+namespace async
+{
+    namespace detail
+    {
+        /**
+         * @brief Whether heavy_barrier can make every thread of the process execute a full fence, checked once.
+         */
+        inline bool membarrier_available() noexcept
+        {
+#if defined(__linux__) && defined(SYS_membarrier)
+            static const bool available = []
+            {
+                const auto commands = ::syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+                return commands >= 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) != 0 &&
+                       ::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+            }();
+            return available;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief The cheap half of an asymmetric Dekker fence, only a compiler barrier where membarrier exists.
+         */
+        inline void light_barrier(bool asymmetric = membarrier_available()) noexcept
+        {
+            if (asymmetric)
+            {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+            else
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        /**
+         * @brief The expensive half, a full fence on every running thread of the process.
+         */
+        inline void heavy_barrier(bool asymmetric = membarrier_available()) noexcept
+        {
+#if defined(__linux__) && defined(SYS_membarrier)
+            if (asymmetric)
+            {
+                ::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+                return;
+            }
+#endif
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        template <typename T>
+        struct pop_waiter
+        {
+            std::optional<T> item;
+            std::coroutine_handle<> handle;
+            pop_waiter *next = nullptr;
+        };
+
+        /**
+         * @brief Consumers waiting on an empty container: threads parked on an atomic wait and suspended coroutines.
+         *
+         * The container calls notify after publishing elements. While nobody waits it costs one load behind a
+         * compiler barrier, waiters register and pay for a process wide membarrier before retrying their pop,
+         * so either the retry sees the element or notify sees them. Without membarrier both sides fence.
+         * Suspended coroutines are handed an element under the lock and resumed on the notifying thread.
+         */
+        template <typename T>
+        class pop_waiters
+        {
+        public:
+            /**
+             * @brief Retries try_pop until it yields an element, parking the thread in between.
+             */
+            template <typename TryPop>
+            T pop(TryPop try_pop)
+            {
+                while (true)
+                {
+                    if (auto item = try_pop())
+                    {
+                        return std::move(*item);
+                    }
+
+                    const auto epoch = _epoch.load(std::memory_order_acquire);
+                    _count.fetch_add(1, std::memory_order_relaxed);
+                    // Pairs with the light barrier in notify: either this retry sees the element or the producer sees us.
+                    heavy_barrier(_asymmetric);
+                    auto item = try_pop();
+                    if (!item)
+                    {
+                        _epoch.wait(epoch, std::memory_order_acquire);
+                    }
+                    _count.fetch_sub(1, std::memory_order_relaxed);
+
+                    if (item)
+                    {
+                        return std::move(*item);
+                    }
+                }
+            }
+
+            /**
+             * @brief Queues waiter unless try_pop finds an element meanwhile, false if it must not suspend.
+             */
+            template <typename TryPop>
+            bool park(pop_waiter<T> &waiter, TryPop try_pop) noexcept
+            {
+                // try_pop may wake coroutines that need the lock, they run once it is released. Only a pop that
+                // found an element wakes anyone, and then waiter was not queued.
+                resume_deferral deferral;
+                std::lock_guard lock(_mutex);
+                _count.fetch_add(1, std::memory_order_relaxed);
+                heavy_barrier(_asymmetric);
+                if ((waiter.item = try_pop()))
+                {
+                    _count.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                if (_back != nullptr)
+                {
+                    _back->next = &waiter;
+                }
+                else
+                {
+                    _front = &waiter;
+                }
+                _back = &waiter;
+                return true;
+            }
+
+            /**
+             * @brief Wakes up to count waiters after count elements were published.
+             */
+            template <typename TryPop>
+            void notify(std::size_t count, TryPop try_pop) noexcept
+            {
+                // The only cost of a push nobody waits for.
+                light_barrier(_asymmetric);
+                if (_count.load(std::memory_order_relaxed) == 0)
+                {
+                    return;
+                }
+
+                // Suspended coroutines cannot retry by themselves, they are handed an element first.
+                for (; count > 0; --count)
+                {
+                    // Coroutines woken by try_pop would need the lock, they run after it is released.
+                    resume_deferral deferral;
+                    pop_waiter<T> *waiter;
+                    {
+                        std::lock_guard lock(_mutex);
+                        if (_front == nullptr)
+                        {
+                            break;
+                        }
+
+                        auto item = try_pop();
+                        if (!item)
+                        {
+                            // Other consumers already took what was pushed.
+                            return;
+                        }
+
+                        waiter = std::exchange(_front, _front->next);
+                        if (_front == nullptr)
+                        {
+                            _back = nullptr;
+                        }
+                        _count.fetch_sub(1, std::memory_order_relaxed);
+                        waiter->item = std::move(item);
+                    }
+                    waiter->handle.resume();
+                }
+
+                if (count > 0 && _count.load(std::memory_order_relaxed) > 0)
+                {
+                    _epoch.fetch_add(1, std::memory_order_release);
+                    if (count == 1)
+                    {
+                        _epoch.notify_one();
+                    }
+                    else
+                    {
+                        _epoch.notify_all();
+                    }
+                }
+            }
+
+        private:
+            // Read by every notify, kept away from whatever the container writes on each push.
+            alignas(cache_line_size) std::atomic<std::size_t> _count = 0;
+            // Looked up once, so a push does not go through the function local static on every notify.
+            const bool _asymmetric = membarrier_available();
+            std::atomic<std::uint32_t> _epoch = 0;
+            std::mutex _mutex;
+            pop_waiter<T> *_front = nullptr;
+            pop_waiter<T> *_back = nullptr;
+        };
+    }
+
+    /**
+     * @brief Awaits the next element of Container, suspending while it is empty.
+     *
+     * Container provides value_type and try_pop(), and befriends pop_awaiter for access to its _waiters.
+     */
+    template <typename Container>
+    class pop_awaiter
+    {
+        using value_type = typename Container::value_type;
+
+    public:
+        explicit pop_awaiter(Container &container) noexcept : _container(container) {}
+
+        bool await_ready() noexcept
+        {
+            _waiter.item = _container.try_pop();
+            return _waiter.item.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            _waiter.handle = handle;
+            return _container._waiters.park(_waiter, [this]
+                                            { return _container.try_pop(); });
+        }
+
+        value_type await_resume()
+        {
+            return std::move(*_waiter.item);
+        }
+
+    private:
+        Container &_container;
+        detail::pop_waiter<value_type> _waiter;
+    };
+}
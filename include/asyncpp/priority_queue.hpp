@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "cache_line.hpp"
+#include "pop_waiters.hpp"
+
+namespace async
+{
+    /**
+     * @brief A relaxed concurrent priority queue (MultiQueue) spreading its elements over many small locked heaps.
+     *
+     * push locks a random heap, try_pop looks at the cached tops of two random heaps and takes from the better one.
+     * With several heaps per thread the locks are almost never contended, the price is that try_pop returns an
+     * element close to the highest priority rather than the highest one, and equal priorities are not popped in
+     * push order. Compare orders priorities like std::priority_queue: with std::less the largest is popped first.
+     */
+    template <typename T, typename Priority = int, typename Compare = std::less<Priority>>
+    class priority_queue
+    {
+        static_assert(std::is_trivially_copyable_v<Priority>, "Priority must be trivially copyable, heap tops are published atomically");
+
+        friend class pop_awaiter<priority_queue>;
+
+    public:
+        using value_type = T;
+
+        /**
+         * @brief Creates a queue with heap_count heaps, by default two per hardware thread.
+         */
+        explicit priority_queue(std::size_t heap_count = 2 * std::max(1u, std::thread::hardware_concurrency()), Compare compare = Compare())
+            : _heaps(std::make_unique<heap[]>(std::max<std::size_t>(heap_count, 2))), _heap_count(std::max<std::size_t>(heap_count, 2)), _compare(std::move(compare))
+        {
+        }
+
+        priority_queue(const priority_queue &) = delete;
+
+        priority_queue &operator=(const priority_queue &) = delete;
+
+        void push(Priority priority, const T &value)
+        {
+            _push(entry{priority, value});
+        }
+
+        void push(Priority priority, T &&value)
+        {
+            _push(entry{priority, std::move(value)});
+        }
+
+        /**
+         * @brief Takes an element of high priority, nullopt if the queue is empty.
+         */
+        std::optional<T> try_pop()
+        {
+            for (std::size_t attempt = 0; attempt < _heap_count; ++attempt)
+            {
+                if (_size.load(std::memory_order_acquire) == 0)
+                {
+                    return std::nullopt;
+                }
+
+                auto &first = _random_heap();
+                auto &second = _random_heap();
+                auto &best = _higher(first, second) ? first : second;
+                std::unique_lock lock(best.mutex, std::try_to_lock);
+                if (lock && !best.entries.empty())
+                {
+                    return _take(best);
+                }
+            }
+
+            // Sampling kept hitting empty or busy heaps, only a full sweep tells the queue is really empty.
+            for (std::size_t i = 0; i < _heap_count; ++i)
+            {
+                std::lock_guard lock(_heaps[i].mutex);
+                if (!_heaps[i].entries.empty())
+                {
+                    return _take(_heaps[i]);
+                }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Takes an element of high priority, parking the calling thread until one is pushed.
+         */
+        T pop()
+        {
+            return _waiters.pop([this]
+                                { return try_pop(); });
+        }
+
+        /**
+         * @brief Awaits an element of high priority, the coroutine is suspended while the queue is empty.
+         *
+         * A suspended coroutine is handed the element directly and resumed on the thread that pushed it.
+         * The queue must outlive every pending pop_async.
+         */
+        pop_awaiter<priority_queue> pop_async() noexcept
+        {
+            return pop_awaiter<priority_queue>(*this);
+        }
+
+        std::size_t size() const noexcept
+        {
+            return _size.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const noexcept
+        {
+            return this->size() == 0;
+        }
+
+    private:
+        struct entry
+        {
+            Priority priority;
+            T value;
+        };
+
+        struct alignas(cache_line_size) heap
+        {
+            std::mutex mutex;
+            std::vector<entry> entries;
+            // Copies of the heap's front for lock-free sampling, only written while holding mutex.
+            std::atomic<Priority> top{};
+            std::atomic<bool> populated = false;
+        };
+
+        std::unique_ptr<heap[]> _heaps;
+        std::size_t _heap_count;
+        Compare _compare;
+        alignas(cache_line_size) std::atomic<std::size_t> _size = 0;
+        detail::pop_waiters<T> _waiters;
+
+        void _push(entry &&item)
+        {
+            while (true)
+            {
+                auto &target = _random_heap();
+                std::unique_lock lock(target.mutex, std::try_to_lock);
+                if (!lock)
+                {
+                    continue;
+                }
+
+                target.entries.push_back(std::move(item));
+                std::push_heap(target.entries.begin(), target.entries.end(), _entry_compare());
+                _publish_top(target);
+                // Counted under the lock, a pop of this element decrements only after it and cannot wrap the size.
+                _size.fetch_add(1, std::memory_order_release);
+                break;
+            }
+
+            _waiters.notify(1, [this]
+                            { return try_pop(); });
+        }
+
+        /**
+         * @brief Pops the front of the locked heap h.
+         */
+        T _take(heap &h)
+        {
+            std::pop_heap(h.entries.begin(), h.entries.end(), _entry_compare());
+            auto value = std::move(h.entries.back().value);
+            h.entries.pop_back();
+            _publish_top(h);
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return value;
+        }
+
+        void _publish_top(heap &h) noexcept
+        {
+            if (!h.entries.empty())
+            {
+                h.top.store(h.entries.front().priority, std::memory_order_relaxed);
+            }
+            h.populated.store(!h.entries.empty(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Whether a's sampled top should be popped before b's, a racy hint that is rechecked under the lock.
+         */
+        bool _higher(const heap &a, const heap &b) const
+        {
+            if (!a.populated.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            if (!b.populated.load(std::memory_order_relaxed))
+            {
+                return true;
+            }
+            return !_compare(a.top.load(std::memory_order_relaxed), b.top.load(std::memory_order_relaxed));
+        }
+
+        auto _entry_compare() const
+        {
+            return [this](const entry &a, const entry &b)
+            { return _compare(a.priority, b.priority); };
+        }
+
+        heap &_random_heap() noexcept
+        {
+            // xorshift64, seeded per thread from its state's address so threads do not walk the heaps in lockstep.
+            thread_local std::uint64_t state = 0;
+            if (state == 0)
+            {
+                state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+            }
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return _heaps[state % _heap_count];
+        }
+    };
+}
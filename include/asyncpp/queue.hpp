@@ -1,211 +1,1073 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "backpressure.hpp"
+#include "cache_line.hpp"
+#include "hazard_pointer.hpp"
+#include "pop_waiters.hpp"
+#include "sequenced_slot.hpp"
 
 namespace async
 {
-    template <typename T, std::size_t NodeCapacity = 1024>
+    namespace producers
+    {
+        /**
+         * @brief Only one thread at a time pushes, publishing needs no read-modify-write.
+         */
+        struct single
+        {
+        };
+
+        struct multi
+        {
+        };
+    }
+
+    namespace consumers
+    {
+        /**
+         * @brief Only one thread at a time pops, taking an element needs no read-modify-write.
+         */
+        struct single
+        {
+        };
+
+        struct multi
+        {
+        };
+    }
+
+    /**
+     * @brief A snapshot of a queue's counters, taken by queue::metrics.
+     *
+     * The counters are approximate while other threads push and pop: slots being claimed count as enqueued or
+     * dequeued before the element is actually written or taken.
+     */
+    struct queue_metrics
+    {
+        std::size_t enqueued = 0;
+        std::size_t dequeued = 0;
+        // Largest depth observed, sampled whenever a segment fills up so it may be off by one segment.
+        std::size_t high_water_mark = 0;
+        std::chrono::steady_clock::time_point timestamp;
+
+        std::size_t size() const noexcept
+        {
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+
+        /**
+         * @brief Elements enqueued per second between since and this snapshot.
+         */
+        double enqueue_rate(const queue_metrics &since) const noexcept
+        {
+            return _rate(enqueued - since.enqueued, since);
+        }
+
+        /**
+         * @brief Elements dequeued per second between since and this snapshot.
+         */
+        double dequeue_rate(const queue_metrics &since) const noexcept
+        {
+            return _rate(dequeued - since.dequeued, since);
+        }
+
+    private:
+        double _rate(std::size_t count, const queue_metrics &since) const noexcept
+        {
+            const auto seconds = std::chrono::duration<double>(timestamp - since.timestamp).count();
+            return seconds > 0 ? static_cast<double>(count) / seconds : 0.0;
+        }
+    };
+
+    /**
+     * @brief An unbounded lock-free queue made of linked fixed size segments.
+     *
+     * Segments are linked through raw pointers and reclaimed with hazard pointers once every thread stopped using them.
+     * Producers and Consumers select the cheapest algorithm that is correct for how the queue is used:
+     * a single producer publishes through a plain index store instead of claiming slots with fetch_add and
+     * per-slot sequence numbers, a single consumer takes elements without a CAS, and hazard pointers are only
+     * taken on the sides that have more than one thread.
+     *
+     * Consumers may also wait for an element, blocked in pop() or suspended in co_await pop_async(). Producers
+     * only look at a waiter count after publishing, the wake up path is skipped entirely while nobody waits.
+     *
+     * A queue constructed with a queue_budget holds producers back once it reached the budget's high water mark:
+     * try_push fails, push blocks and co_await push_async() suspends until consumers drained it to the low water mark.
+     */
+    template <typename T, std::size_t NodeCapacity = 1024, typename Producers = producers::multi, typename Consumers = consumers::multi>
     class queue
     {
+        static_assert(std::is_same_v<Producers, producers::single> || std::is_same_v<Producers, producers::multi>, "Producers must be producers::single or producers::multi");
+
+        static_assert(std::is_same_v<Consumers, consumers::single> || std::is_same_v<Consumers, consumers::multi>, "Consumers must be consumers::single or consumers::multi");
+
+        static constexpr bool multi_producer = std::is_same_v<Producers, producers::multi>;
+
+        static constexpr bool multi_consumer = std::is_same_v<Consumers, consumers::multi>;
+
+        friend class pop_awaiter<queue>;
+
     public:
-        queue() : _head(std::make_shared<ring_node>()), _tail(_head.load(std::memory_order_relaxed)) {}
+        using value_type = T;
 
-        void push(const T &item) noexcept
+        queue() : queue(queue_budget()) {}
+
+        explicit queue(queue_budget budget)
+            : _pool(new segment_pool()), _head(_pool->acquire()), _tail(_head.load(std::memory_order_relaxed)),
+              _admission(_in_elements(budget.high_water, budget.measure), _in_elements(budget.low_water, budget.measure))
         {
-            auto tail = _tail.load();
-            if (tail->try_push(item)) // Buffer still usable?
-                return;
+        }
 
-            // Slow route, we need to create a new buffer
-            auto new_node = std::make_shared<ring_node>();
-            new_node->try_push(item);
-            while (true)
+        queue(const queue &) = delete;
+
+        queue &operator=(const queue &) = delete;
+
+        /**
+         * @brief Pushes item, blocking while a budgeted queue holds producers back.
+         *
+         * Exceptions from copying item or allocating a segment propagate and leave the queue as it was.
+         */
+        void push(const T &item)
+        {
+            _admit(1);
+            _push(item);
+            _notify_waiters(1);
+        }
+
+        void push(T &&item)
+        {
+            _admit(1);
+            _push(std::move(item));
+            _notify_waiters(1);
+        }
+
+        /**
+         * @brief Pushes item unless a budgeted queue holds producers back, never fails without a budget.
+         */
+        bool try_push(const T &item)
+        {
+            return _try_push(item);
+        }
+
+        bool try_push(T &&item)
+        {
+            return _try_push(std::move(item));
+        }
+
+        class push_awaiter
+        {
+        public:
+            push_awaiter(queue &q, T &&item) noexcept : _queue(q), _item(std::move(item)) {}
+
+            bool await_ready() noexcept
             {
-                auto tail = _tail.load();
-                auto next = tail->next.load();
-                if (tail == _tail.load())
+                _admitted = !_queue._admission.limited() || _queue._admission.try_acquire(1);
+                return _admitted;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) noexcept
+            {
+                _waiter.handle = handle;
+                while (!_queue._admission.park(_waiter))
                 {
-                    if (next == nullptr)
-                    {
-                        if (tail->next.compare_exchange_strong(next, new_node))
-                        {
-                            _tail.compare_exchange_strong(tail, new_node);
-                        }
-                        break;
-                    }
-                    else
+                    if (_queue._admission.try_acquire(1))
                     {
-                        _tail.compare_exchange_strong(tail, next);
+                        _admitted = true;
+                        return false;
                     }
                 }
+                return true;
+            }
+
+            void await_resume()
+            {
+                // Woken producers all go ahead, overshooting the high water mark by at most their number.
+                if (!_admitted)
+                {
+                    _queue._admission.admit(1);
+                }
+                _queue._push(std::move(_item));
+                _queue._notify_waiters(1);
             }
+
+        private:
+            queue &_queue;
+            T _item;
+            bool _admitted = false;
+            detail::admission_waiter _waiter;
+        };
+
+        /**
+         * @brief Awaits room in a budgeted queue and pushes item, never suspends without a budget.
+         *
+         * A suspended coroutine is resumed on the thread whose pop drained the queue to the low water mark.
+         */
+        push_awaiter push_async(T item) noexcept
+        {
+            return push_awaiter(*this, std::move(item));
         }
 
-        void push(T &&item) noexcept
+        /**
+         * @brief Pushes [first, last) in order, reserving the slots of each segment with a single atomic operation.
+         *
+         * Elements are copied, or moved when the iterators yield rvalues (std::move_iterator). Input iterators
+         * that cannot be counted up front are pushed one at a time. Elements whose construction may throw are
+         * copied into temporaries before any slot is claimed, a claimed slot always has to be published.
+         */
+        template <std::input_iterator It, std::sentinel_for<It> Sentinel>
+            requires std::is_nothrow_constructible_v<T, std::iter_reference_t<It>> || std::is_nothrow_move_constructible_v<T>
+        void push_range(It first, Sentinel last)
         {
-            auto tail = _tail.load();
-            if (tail->try_push(item)) // Buffer still usable?
-                return;
+            if constexpr (std::forward_iterator<It> && !std::is_nothrow_constructible_v<T, std::iter_reference_t<It>>)
+            {
+                std::vector<T> items;
+                for (; first != last; ++first)
+                {
+                    items.emplace_back(*first);
+                }
 
-            // Slow route, we need to create a new buffer
-            auto new_node = std::make_shared<ring_node>();
-            new_node->try_push(item);
-            while (true)
+                auto moved = std::make_move_iterator(items.begin());
+                _admit(items.size());
+                _push_bulk(moved, items.size());
+                _notify_waiters(items.size());
+            }
+            else if constexpr (std::forward_iterator<It>)
+            {
+                const auto count = static_cast<std::size_t>(std::ranges::distance(first, last));
+                _admit(count);
+                _push_bulk(first, count);
+                _notify_waiters(count);
+            }
+            else
+            {
+                for (; first != last; ++first)
+                {
+                    _admit(1);
+                    _push(*first);
+                    _notify_waiters(1);
+                }
+            }
+        }
+
+        std::optional<T> try_pop() noexcept
+        {
+            auto item = _try_pop();
+            if (item && _admission.limited())
+            {
+                _admission.release(1);
+            }
+            return item;
+        }
+
+        /**
+         * @brief Moves up to max elements to out, claiming each segment's share with a single atomic operation.
+         *
+         * If writing to out throws, the elements already written stay there, the rest of the claimed run is
+         * destroyed and the exception propagates.
+         *
+         * @return The number of elements written to out.
+         */
+        template <std::output_iterator<T &&> OutputIt>
+        std::size_t try_pop_bulk(OutputIt out, std::size_t max)
+        {
+            std::size_t popped = 0;
+            try
+            {
+                _try_pop_bulk(out, max, popped);
+            }
+            catch (...)
+            {
+                _release(popped);
+                throw;
+            }
+
+            if (popped > 0)
+            {
+                _release(popped);
+            }
+            return popped;
+        }
+        /**
+         * @brief Takes the next element, parking the calling thread on an atomic wait until one is pushed.
+         */
+        T pop()
+        {
+            return _waiters.pop([this]
+                                { return try_pop(); });
+        }
+
+        /**
+         * @brief Awaits the next element, the coroutine is suspended while the queue is empty.
+         *
+         * A suspended coroutine is handed the element directly and resumed on the thread that pushed it.
+         * The queue must outlive every pending pop_async.
+         */
+        pop_awaiter<queue> pop_async() noexcept
+        {
+            return pop_awaiter<queue>(*this);
+        }
+
+        /**
+         * @brief The approximate number of elements, computed in constant time from the head and tail segments.
+         */
+        std::size_t size() const
+        {
+            return metrics().size();
+        }
+
+        bool empty() const
+        {
+            return this->size() == 0;
+        }
+
+        /**
+         * @brief Reads the total enqueued and dequeued counts and the high water mark without walking the queue.
+         *
+         * The first call on a thread may allocate its hazard record and throw std::bad_alloc.
+         */
+        queue_metrics metrics() const
+        {
+            // Dequeued first, so a concurrent push in between can only make the depth larger, not negative.
+            hazard_pointer hp;
+            auto head = hp.protect(_head);
+            const auto dequeued = head->base + head->dequeued();
+            auto tail = hp.protect(_tail);
+            const auto enqueued = tail->base + tail->enqueued();
+
+            queue_metrics snapshot;
+            snapshot.enqueued = enqueued;
+            snapshot.dequeued = dequeued;
+            snapshot.high_water_mark = std::max(_high_water_mark.load(std::memory_order_relaxed), snapshot.size());
+            snapshot.timestamp = std::chrono::steady_clock::now();
+            return snapshot;
+        }
+
+        ~queue()
+        {
+            auto node = _head.load();
+            while (node != nullptr)
+            {
+                delete std::exchange(node, node->next.load());
+            }
+            _pool->close();
+        }
+
+    private:
+        using slot_type = std::conditional_t<multi_producer, detail::sequenced_slot<T>, detail::slot_storage<T>>;
+
+        class segment_pool;
+
+        /**
+         * @brief A segment hands out each of its slots exactly once, to one producer and then to one consumer.
+         *
+         * Multiple producers claim slots with a fetch_add and publish them through the slot's sequence number,
+         * a single producer publishes by advancing the enqueue index. Consumers claim published slots in order.
+         * Slots are never reused, so a producer still holding a segment that was already drained cannot
+         * overwrite anything and the segment is done once every slot was consumed.
+         */
+        class segment
+        {
+        public:
+            std::atomic<segment *> next = nullptr;
+
+            // Position of the first slot counted over the whole queue, set before the segment is linked.
+            std::size_t base = 0;
+
+            explicit segment(segment_pool *pool) noexcept : _pool(pool) {}
+
+            segment(const segment &) = delete;
+
+            segment &operator=(const segment &) = delete;
+
+            /**
+             * @brief Constructs item in the next free slot, false if the segment is full.
+             *
+             * The claimed slot is published right after construction, so constructing from item must not throw.
+             */
+            template <typename U>
+            bool try_push(U &&item) noexcept
             {
-                auto tail = _tail.load();
-                auto next = tail->next.load();
-                if (tail == _tail.load())
+                static_assert(std::is_nothrow_constructible_v<T, U>, "queue constructs throwing elements before claiming slots");
+
+                if constexpr (multi_producer)
                 {
-                    if (next == nullptr)
+                    // Checked first so producers bouncing off a full segment do not keep incrementing the counter.
+                    if (_enqueue.load(std::memory_order_relaxed) >= NodeCapacity)
                     {
-                        if (tail->next.compare_exchange_strong(next, new_node))
-                        {
-                            _tail.compare_exchange_strong(tail, new_node);
-                        }
-                        break;
+                        return false;
+                    }
+
+                    const auto pos = _enqueue.fetch_add(1, std::memory_order_relaxed);
+                    if (pos >= NodeCapacity)
+                    {
+                        return false;
                     }
-                    else
+
+                    auto &slot = _slots[pos];
+                    slot.construct(std::forward<U>(item));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                }
+                else
+                {
+                    const auto pos = _enqueue.load(std::memory_order_relaxed);
+                    if (pos >= NodeCapacity)
                     {
-                        _tail.compare_exchange_strong(tail, next);
+                        return false;
                     }
+
+                    _slots[pos].construct(std::forward<U>(item));
+                    _enqueue.store(pos + 1, std::memory_order_release);
                 }
+                return true;
             }
-        }
 
-        std::optional<T> try_pop() noexcept
-        {
-            auto head = _head.load();
-            auto item = head->try_pop();
-            if (item)
-                return *item;
+            /**
+             * @brief Constructs up to count elements from first, advancing it, and returns how many were pushed.
+             *
+             * The claimed slots are published one by one, so constructing from first must not throw.
+             */
+            template <typename It>
+            std::size_t try_push_bulk(It &first, std::size_t count) noexcept
+            {
+                static_assert(std::is_nothrow_constructible_v<T, std::iter_reference_t<It>>, "push_range constructs throwing elements before claiming slots");
 
-            while (true)
+                if (_enqueue.load(std::memory_order_relaxed) >= NodeCapacity)
+                {
+                    return 0;
+                }
+
+                std::size_t pos;
+                if constexpr (multi_producer)
+                {
+                    // Claims past the end of the segment are simply never used.
+                    pos = _enqueue.fetch_add(count, std::memory_order_relaxed);
+                    if (pos >= NodeCapacity)
+                    {
+                        return 0;
+                    }
+                }
+                else
+                {
+                    pos = _enqueue.load(std::memory_order_relaxed);
+                }
+
+                const auto claimed = std::min(count, NodeCapacity - pos);
+                for (std::size_t i = pos; i < pos + claimed; ++i, ++first)
+                {
+                    _slots[i].construct(*first);
+                    if constexpr (multi_producer)
+                    {
+                        _slots[i].sequence.store(i + 1, std::memory_order_release);
+                    }
+                }
+
+                if constexpr (!multi_producer)
+                {
+                    _enqueue.store(pos + claimed, std::memory_order_release);
+                }
+                return claimed;
+            }
+
+            /**
+             * @brief Moves the run of published elements at the front, at most max of them, to out.
+             *
+             * The run is added to popped as soon as it is claimed. If writing to out throws, the rest of the run
+             * is destroyed so the segment can still be drained and reclaimed.
+             */
+            template <typename OutputIt>
+            void try_pop_bulk(OutputIt &out, std::size_t max, std::size_t &popped)
             {
-                auto head = _head.load();
-                auto tail = _tail.load();
-                const auto next = head->next.load();
+                auto pos = _dequeue.load(std::memory_order_relaxed);
+                std::size_t count;
+                while (true)
+                {
+                    const auto end = std::min(NodeCapacity, pos + max);
+                    count = 0;
+                    while (pos + count < end && _published(pos + count))
+                    {
+                        ++count;
+                    }
+
+                    if (count == 0)
+                    {
+                        return;
+                    }
+
+                    if constexpr (multi_consumer)
+                    {
+                        if (!_dequeue.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                        {
+                            continue;
+                        }
+                    }
+                    break;
+                }
+                popped += count;
+
+                // next is the first slot still holding its element, a throwing move leaves it there.
+                auto next = pos;
+                try
+                {
+                    while (next < pos + count)
+                    {
+                        auto item = _slots[next].take();
+                        ++next;
+                        *out = std::move(item);
+                        ++out;
+                    }
+                }
+                catch (...)
+                {
+                    for (; next < pos + count; ++next)
+                    {
+                        _slots[next].destroy();
+                    }
+                    if constexpr (!multi_consumer)
+                    {
+                        _dequeue.store(pos + count, std::memory_order_relaxed);
+                    }
+                    throw;
+                }
 
-                if (head == _head.load())
+                if constexpr (!multi_consumer)
                 {
-                    if (head == tail)
+                    _dequeue.store(pos + count, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * @brief Takes the next element, nullopt if it is not published yet or the segment is exhausted.
+             */
+            std::optional<T> try_pop() noexcept
+            {
+                auto pos = _dequeue.load(std::memory_order_relaxed);
+                if constexpr (multi_consumer)
+                {
+                    while (pos < NodeCapacity)
                     {
-                        if (next == nullptr)
+                        if (!_published(pos))
+                        {
                             return std::nullopt;
+                        }
 
-                        _tail.compare_exchange_strong(tail, next);
+                        if (_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            return _slots[pos].take();
+                        }
+                    }
+                    return std::nullopt;
+                }
+                else
+                {
+                    if (pos >= NodeCapacity || !_published(pos))
+                    {
+                        return std::nullopt;
                     }
-                    else
+
+                    auto item = _slots[pos].take();
+                    _dequeue.store(pos + 1, std::memory_order_relaxed);
+                    return item;
+                }
+            }
+
+            bool exhausted() const noexcept
+            {
+                return _dequeue.load(std::memory_order_relaxed) >= NodeCapacity;
+            }
+
+            segment_pool *pool() const noexcept
+            {
+                return _pool;
+            }
+
+            /**
+             * @brief Brings a drained segment nobody else can reach back to its freshly constructed state.
+             */
+            void reset() noexcept
+            {
+                if constexpr (multi_producer)
+                {
+                    for (auto &slot : _slots)
                     {
-                        if (next == nullptr)
-                            return std::nullopt;
+                        slot.sequence.store(0, std::memory_order_relaxed);
+                    }
+                }
+                next.store(nullptr, std::memory_order_relaxed);
+                base = 0;
+                _enqueue.store(0, std::memory_order_relaxed);
+                _dequeue.store(0, std::memory_order_relaxed);
+                _cached_enqueue = 0;
+            }
+
+            std::size_t enqueued() const noexcept
+            {
+                return std::min(_enqueue.load(std::memory_order_relaxed), NodeCapacity);
+            }
+
+            std::size_t dequeued() const noexcept
+            {
+                return std::min(_dequeue.load(std::memory_order_relaxed), NodeCapacity);
+            }
 
-                        if (_head.compare_exchange_strong(head, next))
+            ~segment()
+            {
+                const auto enqueued = std::min(_enqueue.load(std::memory_order_relaxed), NodeCapacity);
+                for (auto i = _dequeue.load(std::memory_order_relaxed); i < enqueued; ++i)
+                {
+                    if constexpr (multi_producer)
+                    {
+                        if (_slots[i].sequence.load(std::memory_order_relaxed) != i + 1)
                         {
-                            return next->try_pop();
+                            continue;
                         }
                     }
+                    _slots[i].destroy();
                 }
             }
-        }
 
-        std::size_t size() const noexcept
+        private:
+            segment_pool *_pool;
+            slot_type _slots[NodeCapacity];
+
+            // Written by producers, read by consumers only while a single producer publishes through it.
+            alignas(cache_line_size) std::atomic<std::size_t> _enqueue = 0;
+
+            // Written by consumers, a single consumer keeps its own view of how far the producer got.
+            alignas(cache_line_size) std::atomic<std::size_t> _dequeue = 0;
+            std::size_t _cached_enqueue = 0;
+
+            bool _published(std::size_t pos) noexcept
+            {
+                if constexpr (multi_producer)
+                {
+                    return _slots[pos].sequence.load(std::memory_order_acquire) == pos + 1;
+                }
+                else if constexpr (multi_consumer)
+                {
+                    return pos < _enqueue.load(std::memory_order_acquire);
+                }
+                else
+                {
+                    if (pos < _cached_enqueue)
+                    {
+                        return true;
+                    }
+                    _cached_enqueue = _enqueue.load(std::memory_order_acquire);
+                    return pos < _cached_enqueue;
+                }
+            }
+        };
+
+        /**
+         * @brief Keeps a few drained segments for reuse, so a queue cycling through segments stops allocating.
+         *
+         * Retired segments come back from whichever thread reclaims them, possibly after the queue is gone.
+         * Each of them holds a reference, the pool frees itself once the queue closed it and the last one returned.
+         */
+        class segment_pool
         {
-            auto head = _head.load();
-            std::size_t count = 0;
-            while (head != nullptr)
+        public:
+            segment_pool()
             {
-                count += head->size();
-                head = head->next.load();
+                _free.reserve(_max_segments);
             }
-            return count;
-        }
 
-        bool empty() const noexcept
+            segment *acquire()
+            {
+                {
+                    std::lock_guard lock(_mutex);
+                    if (!_free.empty())
+                    {
+                        auto recycled = _free.back();
+                        _free.pop_back();
+                        return recycled;
+                    }
+                }
+                return new segment(this);
+            }
+
+            /**
+             * @brief Takes back a segment no other thread can reach anymore.
+             */
+            void recycle(segment *drained) noexcept
+            {
+                drained->reset();
+                {
+                    std::lock_guard lock(_mutex);
+                    if (!_closed && _free.size() < _max_segments)
+                    {
+                        _free.push_back(drained);
+                        return;
+                    }
+                }
+                delete drained;
+            }
+
+            void retain() noexcept
+            {
+                _references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release() noexcept
+            {
+                if (_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete this;
+                }
+            }
+
+            /**
+             * @brief Frees the pooled segments and drops the queue's reference, later returns are deleted.
+             */
+            void close() noexcept
+            {
+                std::vector<segment *> pooled;
+                {
+                    std::lock_guard lock(_mutex);
+                    _closed = true;
+                    pooled.swap(_free);
+                }
+
+                for (auto drained : pooled)
+                {
+                    delete drained;
+                }
+                release();
+            }
+
+        private:
+            static constexpr std::size_t _max_segments = 4;
+
+            std::mutex _mutex;
+            std::vector<segment *> _free;
+            bool _closed = false;
+            std::atomic<std::size_t> _references = 1;
+        };
+
+        /**
+         * @brief Reclaims a retired segment into the pool it came from.
+         */
+        struct segment_reclaim
         {
-            return this->size() == 0;
-        }
+            void operator()(segment *retired) const noexcept
+            {
+                auto pool = retired->pool();
+                pool->recycle(retired);
+                pool->release();
+            }
+        };
 
-    private:
-        class ring_node
+        /**
+         * @brief Protects a segment only when other threads of the same side could retire it meanwhile.
+         */
+        template <bool Shared>
+        class segment_guard
         {
         public:
-            std::atomic<std::shared_ptr<ring_node>> next;
+            segment *protect(const std::atomic<segment *> &source) noexcept
+            {
+                if constexpr (Shared)
+                {
+                    return _hp.protect(source);
+                }
+                else
+                {
+                    return source.load(std::memory_order_acquire);
+                }
+            }
+
+            void reset() noexcept
+            {
+                if constexpr (Shared)
+                {
+                    _hp.reset();
+                }
+            }
+
+        private:
+            [[no_unique_address]] std::conditional_t<Shared, hazard_pointer, std::monostate> _hp;
+        };
 
-            ring_node() : _head(0), _tail(0) {}
+        segment_pool *_pool;
+        alignas(cache_line_size) std::atomic<segment *> _head;
+        // Base of the head segment, lets producers estimate the depth without protecting the head.
+        std::atomic<std::size_t> _head_base = 0;
+        alignas(cache_line_size) std::atomic<segment *> _tail;
+        std::atomic<std::size_t> _high_water_mark = 0;
 
-            bool try_push(const T &item) noexcept
+        detail::pop_waiters<T> _waiters;
+        detail::admission _admission;
+
+        static std::size_t _in_elements(std::size_t amount, queue_budget::unit measure) noexcept
+        {
+            if (measure == queue_budget::unit::elements || amount == std::numeric_limits<std::size_t>::max())
             {
-                auto tail = _tail.load();
-                auto head = _head.load();
+                return amount;
+            }
+            return amount / sizeof(slot_type);
+        }
 
-                // Buffers full
-                if ((tail + 1) % NodeCapacity == head)
-                    return false;
+        void _admit(std::size_t count) noexcept
+        {
+            if (_admission.limited())
+            {
+                _admission.acquire(count);
+            }
+        }
 
-                // Check if the tail is still consistent, if it is, we can just update the tail, if not we retry the entire operation.
-                if (!_tail.compare_exchange_strong(tail, (tail + 1) % NodeCapacity))
-                    return try_push(item);
+        /**
+         * @brief Hands back room admitted for count elements that were not pushed.
+         */
+        void _release(std::size_t count) noexcept
+        {
+            if (_admission.limited())
+            {
+                _admission.release(count);
+            }
+        }
 
-                // Succeeded, so we're safe to update the data.
-                _data[tail] = std::move(item);
-                return true;
+        template <typename U>
+        bool _try_push(U &&item)
+        {
+            if (_admission.limited() && !_admission.try_acquire(1))
+            {
+                return false;
             }
 
-            bool try_push(T &&item) noexcept
+            _push(std::forward<U>(item));
+            _notify_waiters(1);
+            return true;
+        }
+
+        /**
+         * @brief Pushes item into room it was admitted for, handing the room back if the push throws.
+         *
+         * Throwing constructors run before a slot is claimed, a claimed slot always has to be published.
+         * Elements that can neither be constructed from item nor moved without throwing are rejected at compile time.
+         */
+        template <typename U>
+        void _push(U &&item)
+        {
+            static_assert(std::is_nothrow_constructible_v<T, U> || std::is_nothrow_move_constructible_v<T>,
+                          "queue elements must be nothrow move constructible, or nothrow constructible from what is pushed");
+
+            if constexpr (!std::is_nothrow_constructible_v<T, U> && std::is_nothrow_move_constructible_v<T>)
+            {
+                std::optional<T> value;
+                try
+                {
+                    value.emplace(std::forward<U>(item));
+                }
+                catch (...)
+                {
+                    _release(1);
+                    throw;
+                }
+                _push(std::move(*value));
+            }
+            else
             {
-                auto tail = _tail.load();
-                auto head = _head.load();
+                segment_guard<multi_producer> guard;
+                segment *spare = nullptr;
+                try
+                {
+                    while (true)
+                    {
+                        auto tail = guard.protect(_tail);
+                        // Rvalues are only moved from by the push that succeeds.
+                        if (tail->try_push(std::forward<U>(item)))
+                        {
+                            break;
+                        }
+                        _grow(tail, spare);
+                    }
+                }
+                catch (...)
+                {
+                    // Only allocating a segment can throw here, it happens before a slot is claimed.
+                    _release(1);
+                    throw;
+                }
 
-                // Buffers full
-                if ((tail + 1) % NodeCapacity == head)
-                    return false;
+                if (spare != nullptr)
+                {
+                    _pool->recycle(spare);
+                }
+            }
+        }
 
-                // Check if the tail is still consistent, if it is, we can just update the tail, if not we retry the entire operation.
-                if (!_tail.compare_exchange_strong(tail, (tail + 1) % NodeCapacity))
-                    return try_push(std::move(item));
+        template <typename It>
+        void _push_bulk(It &first, std::size_t count)
+        {
+            segment_guard<multi_producer> guard;
+            segment *spare = nullptr;
+            auto remaining = count;
+            try
+            {
+                while (remaining > 0)
+                {
+                    auto tail = guard.protect(_tail);
+                    remaining -= tail->try_push_bulk(first, remaining);
+                    if (remaining > 0)
+                    {
+                        _grow(tail, spare);
+                    }
+                }
+            }
+            catch (...)
+            {
+                // Allocating a segment failed, the elements pushed before it stay in the queue.
+                _release(remaining);
+                _notify_waiters(count - remaining);
+                throw;
+            }
 
-                // Succeeded, so we're safe to update the data.
-                _data[tail] = std::move(item);
-                return true;
+            if (spare != nullptr)
+            {
+                _pool->recycle(spare);
             }
+        }
 
-            std::optional<T> try_pop() noexcept
+        std::optional<T> _try_pop() noexcept
+        {
+            segment_guard<multi_consumer> guard;
+            while (true)
             {
-                auto tail = _tail.load();
-                auto head = _head.load();
-                if (head == tail) // No data available.
+                auto head = guard.protect(_head);
+                if (auto item = head->try_pop())
+                {
+                    return item;
+                }
+
+                if (!_advance_head(head, guard))
+                {
                     return std::nullopt;
+                }
+            }
+        }
+
+        template <typename OutputIt>
+        void _try_pop_bulk(OutputIt &out, std::size_t max, std::size_t &popped)
+        {
+            segment_guard<multi_consumer> guard;
+            while (popped < max)
+            {
+                auto head = guard.protect(_head);
+                head->try_pop_bulk(out, max - popped, popped);
+                if (popped == max || !_advance_head(head, guard))
+                {
+                    break;
+                }
+            }
+        }
+
+
+        void _notify_waiters(std::size_t count) noexcept
+        {
+            _waiters.notify(count, [this]
+                            { return try_pop(); });
+        }
+
+        /**
+         * @brief Makes sure the full segment tail has a successor and the tail moved on to it.
+         */
+        void _grow(segment *tail, segment *&spare)
+        {
+            // A single producer holds no hazard pointer, consumers may reclaim tail as soon as its successor is linked.
+            const auto enqueued = tail->base + NodeCapacity;
+            if constexpr (multi_producer)
+            {
+                auto next = tail->next.load(std::memory_order_acquire);
+                if (next != nullptr)
+                {
+                    _tail.compare_exchange_strong(tail, next);
+                    return;
+                }
+
+                // Link an empty segment and retry, whoever gets there first may fill it.
+                if (spare == nullptr)
+                {
+                    spare = _pool->acquire();
+                }
 
-                // Check if the head is still consistent, if it is, we can just update the head, if not we retry the entire operation.
-                if (!_head.compare_exchange_strong(head, (head + 1) % NodeCapacity))
-                    return try_pop();
+                spare->base = enqueued;
+                if (tail->next.compare_exchange_strong(next, spare))
+                {
+                    _tail.compare_exchange_strong(tail, spare);
+                    spare = nullptr;
+                }
+            }
+            else
+            {
+                // Nobody else links segments, the new one becomes the tail before consumers can see it.
+                auto fresh = _pool->acquire();
+                fresh->base = enqueued;
+                _tail.store(fresh);
+                tail->next.store(fresh, std::memory_order_release);
+            }
+            _record_depth(enqueued);
+        }
 
-                // Succeeeded, so we're safe to grab the data.
-                auto item = std::move(_data[head]);
-                return item;
+        /**
+         * @brief Raises the high water mark to the depth implied by enqueued, called once per filled segment.
+         */
+        void _record_depth(std::size_t enqueued) noexcept
+        {
+            const auto head_base = _head_base.load(std::memory_order_relaxed);
+            const auto depth = enqueued > head_base ? enqueued - head_base : 0;
+            auto high = _high_water_mark.load(std::memory_order_relaxed);
+            while (depth > high && !_high_water_mark.compare_exchange_weak(high, depth, std::memory_order_relaxed))
+            {
             }
+        }
 
-            std::size_t size() const noexcept
+        /**
+         * @brief Moves the head past the exhausted segment head, false if there is nothing to move on to yet.
+         */
+        bool _advance_head(segment *head, segment_guard<multi_consumer> &guard) noexcept
+        {
+            // Elements still being published keep the segment alive, they are next in line.
+            auto next = head->next.load(std::memory_order_acquire);
+            if (next == nullptr || !head->exhausted())
             {
-                auto tail = _tail.load();
-                auto head = _head.load();
+                return false;
+            }
 
-                if (head > tail)
-                    return head - tail;
-                else if (head == tail)
-                    return 0;
-                else
-                    return (tail - head);
+            // Help a producer that linked a segment but did not swing the tail yet, the head never passes the tail.
+            auto tail = _tail.load();
+            if (head == tail)
+            {
+                _tail.compare_exchange_strong(tail, next);
             }
 
-        private:
-            T _data[NodeCapacity];
-            std::atomic<std::size_t> _head;
-            std::atomic<std::size_t> _tail;
-        };
+            if constexpr (multi_consumer)
+            {
+                if (!_head.compare_exchange_strong(head, next))
+                {
+                    return true;
+                }
+            }
+            else
+            {
+                _head.store(next);
+            }
+            _head_base.store(head->base + NodeCapacity, std::memory_order_relaxed);
 
-        std::atomic<std::shared_ptr<ring_node>> _head;
-        std::atomic<std::shared_ptr<ring_node>> _tail;
+            guard.reset();
+            _pool->retain();
+            retire(head, segment_reclaim{});
+            return true;
+        }
     };
 }
@@ -0,0 +1,23 @@
+#pragma once
+#include <exception>
+
+namespace async
+{
+    class queue_full_exception : public std::exception
+    {
+    public:
+        const char *what() const noexcept
+        {
+            return "queue full";
+        }
+    };
+
+    class queue_empty_exception : public std::exception
+    {
+    public:
+        const char *what() const noexcept
+        {
+            return "queue empty";
+        }
+    };
+}
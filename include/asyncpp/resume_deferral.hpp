@@ -0,0 +1,94 @@
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <utility>
+
+namespace async
+{
+    namespace detail
+    {
+        struct deferred_waiter
+        {
+            std::coroutine_handle<> handle;
+            deferred_waiter *next = nullptr;
+        };
+
+        /**
+         * @brief Marks a region in which the thread holds a lock that resumed coroutines might need.
+         *
+         * Coroutines woken through resume inside such a region are queued on the thread and resumed once its
+         * outermost region ended, so they never run under the lock. Outside any region they are resumed at once.
+         * Declare the deferral before the lock guard so the lock is released first.
+         */
+        class resume_deferral
+        {
+        public:
+            resume_deferral() noexcept
+            {
+                ++_state().depth;
+            }
+
+            resume_deferral(const resume_deferral &) = delete;
+
+            resume_deferral &operator=(const resume_deferral &) = delete;
+
+            ~resume_deferral()
+            {
+                auto &state = _state();
+                if (--state.depth > 0)
+                {
+                    return;
+                }
+
+                // Resumed coroutines may defer more of them in regions of their own, which drain themselves.
+                while (state.front != nullptr)
+                {
+                    auto waiter = std::exchange(state.front, state.front->next);
+                    if (state.front == nullptr)
+                    {
+                        state.back = nullptr;
+                    }
+                    waiter->handle.resume();
+                }
+            }
+
+            /**
+             * @brief Resumes waiter now, or once the thread left its outermost region.
+             */
+            static void resume(deferred_waiter &waiter) noexcept
+            {
+                auto &state = _state();
+                if (state.depth == 0)
+                {
+                    waiter.handle.resume();
+                    return;
+                }
+
+                waiter.next = nullptr;
+                if (state.back != nullptr)
+                {
+                    state.back->next = &waiter;
+                }
+                else
+                {
+                    state.front = &waiter;
+                }
+                state.back = &waiter;
+            }
+
+        private:
+            struct thread_state
+            {
+                std::size_t depth = 0;
+                deferred_waiter *front = nullptr;
+                deferred_waiter *back = nullptr;
+            };
+
+            static thread_state &_state() noexcept
+            {
+                thread_local thread_state state;
+                return state;
+            }
+        };
+    }
+}
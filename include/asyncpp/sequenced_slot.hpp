@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace async::detail
+{
+    /**
+     * @brief Uninitialized storage for one queue element.
+     *
+     * The element is only constructed between a producer publishing the slot and a consumer taking it,
+     * so T needs neither a default constructor nor assignment.
+     */
+    template <typename T>
+    struct slot_storage
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        template <typename... Args>
+        void construct(Args &&...args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+        {
+            ::new (static_cast<void *>(storage)) T(std::forward<Args>(args)...);
+        }
+
+        T &value() noexcept
+        {
+            return *std::launder(reinterpret_cast<T *>(storage));
+        }
+
+        T take() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            T result = std::move(value());
+            std::destroy_at(&value());
+            return result;
+        }
+
+        void destroy() noexcept
+        {
+            std::destroy_at(&value());
+        }
+    };
+
+    /**
+     * @brief Slot storage plus the sequence number ordering its publication and consumption.
+     */
+    template <typename T>
+    struct sequenced_slot : slot_storage<T>
+    {
+        std::atomic<std::size_t> sequence = 0;
+    };
+}
@@ -0,0 +1,413 @@
+#pragma once
+#if !defined(__linux__)
+#error "shm_bounded_queue requires Linux (memfd_create, shm_open and futex)"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "cache_line.hpp"
+
+namespace async
+{
+    namespace detail
+    {
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                      "shared memory atomics must be lock-free to be address-free");
+
+        static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex words must be plain 32 bit integers");
+
+        // Shared futexes, unlike std::atomic::wait, also wake waiters of other processes mapping the same page.
+        inline void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected) noexcept
+        {
+            ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+        }
+
+        inline void futex_wake(std::atomic<std::uint32_t> &word, int count) noexcept
+        {
+            ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+        }
+
+        [[noreturn]] inline void throw_errno(const char *what)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+    }
+
+    /**
+     * @brief A bounded_queue whose ring lives in shared memory, for exchanging fixed size records between processes.
+     *
+     * The mapping holds a header and the slots, every reference inside it is an index or an offset from the
+     * mapping's start so each process may map it at a different address. Slots are ordered with sequence numbers
+     * like bounded_queue, so try_push and try_pop never enter the kernel; push and pop park on shared futexes and
+     * the other side only issues a wake up while someone is parked. A process dying between claiming and
+     * publishing a slot leaves the queue stuck at that slot.
+     */
+    template <typename T>
+    class shm_bounded_queue
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "shm_bounded_queue elements are copied byte-wise between processes");
+
+    public:
+        /**
+         * @brief Creates the named shared memory object name (see shm_open) holding a queue of capacity slots.
+         *
+         * Fails if the object already exists, capacity is rounded up to a power of two of at least 2.
+         */
+        static shm_bounded_queue create(const std::string &name, std::size_t capacity)
+        {
+            const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (fd < 0)
+            {
+                detail::throw_errno("shm_open");
+            }
+            return _create(fd, capacity);
+        }
+
+        /**
+         * @brief Maps the queue another process created under name.
+         */
+        static shm_bounded_queue open(const std::string &name)
+        {
+            const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+            if (fd < 0)
+            {
+                detail::throw_errno("shm_open");
+            }
+            return _attach(fd);
+        }
+
+        /**
+         * @brief Creates a queue backed by an anonymous memfd, shared through fork or by passing fd() over a socket.
+         */
+        static shm_bounded_queue create_anonymous(std::size_t capacity)
+        {
+            const int fd = ::memfd_create("asyncpp_shm_bounded_queue", MFD_CLOEXEC);
+            if (fd < 0)
+            {
+                detail::throw_errno("memfd_create");
+            }
+            return _create(fd, capacity);
+        }
+
+        /**
+         * @brief Maps the queue behind fd, taking ownership of fd.
+         */
+        static shm_bounded_queue from_fd(int fd)
+        {
+            return _attach(fd);
+        }
+
+        static void unlink(const std::string &name)
+        {
+            if (::shm_unlink(name.c_str()) != 0)
+            {
+                detail::throw_errno("shm_unlink");
+            }
+        }
+
+        shm_bounded_queue(shm_bounded_queue &&other) noexcept
+            : _fd(std::exchange(other._fd, -1)), _mapping(std::exchange(other._mapping, nullptr)), _mapping_size(std::exchange(other._mapping_size, 0))
+        {
+        }
+
+        shm_bounded_queue &operator=(shm_bounded_queue &&other) noexcept
+        {
+            std::swap(_fd, other._fd);
+            std::swap(_mapping, other._mapping);
+            std::swap(_mapping_size, other._mapping_size);
+            return *this;
+        }
+
+        int fd() const noexcept
+        {
+            return _fd;
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return static_cast<std::size_t>(_header().capacity);
+        }
+
+        bool try_push(const T &item) noexcept
+        {
+            auto &h = _header();
+            auto tail = h.tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &slot = _slot(tail);
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::int64_t>(sequence - tail);
+                if (diff == 0)
+                {
+                    if (h.tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                    {
+                        slot.value = item;
+                        slot.sequence.store(tail + 1, std::memory_order_release);
+                        _wake(h.consumers_waiting, h.not_empty);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // full
+                    return false;
+                }
+                else
+                {
+                    // another producer took this slot, catch up.
+                    tail = h.tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::optional<T> try_pop() noexcept
+        {
+            auto &h = _header();
+            auto head = h.head.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto &slot = _slot(head);
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::int64_t>(sequence - (head + 1));
+                if (diff == 0)
+                {
+                    if (h.head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                    {
+                        T item = slot.value;
+                        slot.sequence.store(head + h.capacity, std::memory_order_release);
+                        _wake(h.producers_waiting, h.not_full);
+                        return item;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // empty
+                    return std::nullopt;
+                }
+                else
+                {
+                    // another consumer took this slot, catch up.
+                    head = h.head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Pushes item, parking on a shared futex while the queue is full.
+         */
+        void push(const T &item) noexcept
+        {
+            auto &h = _header();
+            while (!try_push(item))
+            {
+                _park(h.producers_waiting, h.not_full, [&]
+                      { return _slot(h.tail.load()).sequence.load() == h.tail.load(); });
+            }
+        }
+
+        /**
+         * @brief Takes the front element, parking on a shared futex while the queue is empty.
+         */
+        T pop() noexcept
+        {
+            auto &h = _header();
+            while (true)
+            {
+                if (auto item = try_pop())
+                {
+                    return *item;
+                }
+
+                _park(h.consumers_waiting, h.not_empty, [&]
+                      { return _slot(h.head.load()).sequence.load() == h.head.load() + 1; });
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            const auto &h = _header();
+            const auto head = h.head.load();
+            const auto tail = h.tail.load();
+            return tail > head ? static_cast<std::size_t>(tail - head) : 0;
+        }
+
+        ~shm_bounded_queue()
+        {
+            if (_mapping != nullptr)
+            {
+                ::munmap(_mapping, _mapping_size);
+            }
+
+            if (_fd >= 0)
+            {
+                ::close(_fd);
+            }
+        }
+
+    private:
+        static constexpr std::uint64_t _magic = 0x6173796e63707100; // "asyncpq"
+
+        static constexpr std::uint32_t _version = 1;
+
+        struct header
+        {
+            std::atomic<std::uint64_t> magic;
+            std::uint32_t version;
+            std::uint32_t element_size;
+            std::uint64_t capacity;
+            std::uint64_t slots_offset;
+
+            alignas(cache_line_size) std::atomic<std::uint64_t> head;
+            std::atomic<std::uint32_t> producers_waiting;
+            std::atomic<std::uint32_t> not_full;
+
+            alignas(cache_line_size) std::atomic<std::uint64_t> tail;
+            std::atomic<std::uint32_t> consumers_waiting;
+            std::atomic<std::uint32_t> not_empty;
+        };
+
+        struct slot
+        {
+            std::atomic<std::uint64_t> sequence;
+            T value;
+        };
+
+        static constexpr std::uint64_t _slots_offset = (sizeof(header) + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+
+        int _fd = -1;
+        void *_mapping = nullptr;
+        std::size_t _mapping_size = 0;
+
+        shm_bounded_queue(int fd, void *mapping, std::size_t mapping_size) noexcept
+            : _fd(fd), _mapping(mapping), _mapping_size(mapping_size)
+        {
+        }
+
+        static void *_map(int fd, std::size_t size)
+        {
+            auto mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                const auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::system_category(), "mmap");
+            }
+            return mapping;
+        }
+
+        static shm_bounded_queue _create(int fd, std::size_t capacity)
+        {
+            // A single slot would publish the sequence that also frees it for the next lap, see bounded_queue.
+            const auto slots = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+            const auto size = static_cast<std::size_t>(_slots_offset) + slots * sizeof(slot);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                const auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::system_category(), "ftruncate");
+            }
+
+            shm_bounded_queue queue(fd, _map(fd, size), size);
+            auto h = ::new (queue._mapping) header{};
+            h->version = _version;
+            h->element_size = sizeof(T);
+            h->capacity = slots;
+            h->slots_offset = _slots_offset;
+            for (std::uint64_t i = 0; i < slots; ++i)
+            {
+                ::new (static_cast<void *>(&queue._slot(i))) slot{};
+                queue._slot(i).sequence.store(i, std::memory_order_relaxed);
+            }
+            // Published last, openers check it before trusting anything else in the mapping.
+            h->magic.store(_magic, std::memory_order_release);
+            return queue;
+        }
+
+        static shm_bounded_queue _attach(int fd)
+        {
+            struct stat status;
+            if (::fstat(fd, &status) != 0)
+            {
+                const auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::system_category(), "fstat");
+            }
+
+            const auto size = static_cast<std::size_t>(status.st_size);
+            if (size < sizeof(header))
+            {
+                ::close(fd);
+                throw std::runtime_error("shm_bounded_queue: mapping too small");
+            }
+
+            shm_bounded_queue queue(fd, _map(fd, size), size);
+            const auto &h = queue._header();
+            if (h.magic.load(std::memory_order_acquire) != _magic || h.version != _version || h.element_size != sizeof(T) ||
+                h.slots_offset != _slots_offset || !std::has_single_bit(h.capacity) || h.capacity < 2 || size < _slots_offset + h.capacity * sizeof(slot))
+            {
+                throw std::runtime_error("shm_bounded_queue: mapping is not an initialized queue of this element type");
+            }
+            return queue;
+        }
+
+        header &_header() noexcept
+        {
+            return *std::launder(static_cast<header *>(_mapping));
+        }
+
+        const header &_header() const noexcept
+        {
+            return *std::launder(static_cast<const header *>(_mapping));
+        }
+
+        slot &_slot(std::uint64_t position) noexcept
+        {
+            auto slots = std::launder(reinterpret_cast<slot *>(static_cast<char *>(_mapping) + _slots_offset));
+            return slots[position & (_header().capacity - 1)];
+        }
+
+        /**
+         * @brief Sleeps on epoch unless ready, the waiting count tells the other side a wake up is needed.
+         */
+        template <typename Ready>
+        static void _park(std::atomic<std::uint32_t> &waiting, std::atomic<std::uint32_t> &epoch, Ready &&ready) noexcept
+        {
+            const auto observed = epoch.load(std::memory_order_acquire);
+            waiting.fetch_add(1, std::memory_order_relaxed);
+            // Pairs with the fence in _wake: either ready sees the other side's update or it sees us waiting.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!ready())
+            {
+                detail::futex_wait(epoch, observed);
+            }
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        static void _wake(std::atomic<std::uint32_t> &waiting, std::atomic<std::uint32_t> &epoch) noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiting.load(std::memory_order_relaxed) > 0)
+            {
+                epoch.fetch_add(1, std::memory_order_release);
+                detail::futex_wake(epoch, 1);
+            }
+        }
+    };
+}
@@ -0,0 +1,734 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ASYNCPP_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 and SSE4.1 instructions inside functions explicitly targeting them,
+// MSVC allows the intrinsics anywhere.
+#if defined(ASYNCPP_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ASYNCPP_TARGET_AVX2 __attribute__((target("avx2")))
+#define ASYNCPP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define ASYNCPP_TARGET_AVX2
+#define ASYNCPP_TARGET_SSE41
+#endif
+
+namespace async
+{
+    /**
+     * @brief Floating point summation algorithm, integral sums are always exact.
+     */
+    enum class summation
+    {
+        naive,
+        pairwise,
+        kahan
+    };
+
+    /**
+     * @brief The accumulator type of a sum, integers are widened to 64 bits.
+     */
+    template <typename T>
+    using sum_t = std::conditional_t<std::is_floating_point_v<T>, T,
+                                     std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+    namespace simd
+    {
+        inline bool has_avx2() noexcept
+        {
+#if defined(ASYNCPP_SIMD_X86)
+            static const bool supported = []
+            {
+#if defined(_MSC_VER)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                {
+                    return false;
+                }
+
+                // AVX state has to be enabled by the OS as well.
+                __cpuid(info, 1);
+                if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+                {
+                    return false;
+                }
+
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+#endif
+            }();
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        inline bool has_sse41() noexcept
+        {
+#if defined(ASYNCPP_SIMD_X86)
+            static const bool supported = []
+            {
+#if defined(_MSC_VER)
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 19)) != 0;
+#else
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("sse4.1") != 0;
+#endif
+            }();
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+        template <std::integral T>
+        T checked_add(T a, T b)
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                if ((b > 0 && a > std::numeric_limits<T>::max() - b) ||
+                    (b < 0 && a < std::numeric_limits<T>::min() - b))
+                {
+                    throw std::overflow_error("sum");
+                }
+            }
+            else if (a > std::numeric_limits<T>::max() - b)
+            {
+                throw std::overflow_error("sum");
+            }
+            return a + b;
+        }
+
+        namespace detail
+        {
+            inline constexpr std::size_t scalar_lanes = 8;
+
+            inline constexpr std::size_t pairwise_block = 256;
+
+            // Narrow integers summed into 64 bits cannot overflow within a chunk of this many elements.
+            inline constexpr std::size_t widened_chunk = std::size_t(1) << 31;
+
+            template <typename T>
+            sum_t<T> scalar_sum(const T *data, std::size_t size) noexcept
+            {
+                // Independent accumulators break the dependency chain and let the compiler use SSE.
+                sum_t<T> acc[scalar_lanes] = {};
+                std::size_t i = 0;
+                for (; i + scalar_lanes <= size; i += scalar_lanes)
+                {
+                    for (std::size_t j = 0; j < scalar_lanes; ++j)
+                    {
+                        acc[j] += data[i + j];
+                    }
+                }
+
+                sum_t<T> result = 0;
+                for (auto a : acc)
+                {
+                    result += a;
+                }
+                for (; i < size; ++i)
+                {
+                    result += data[i];
+                }
+                return result;
+            }
+
+            template <std::floating_point T>
+            void kahan_add(T &sum, T &compensation, T value) noexcept
+            {
+                const T y = value - compensation;
+                const T t = sum + y;
+                compensation = (t - sum) - y;
+                sum = t;
+            }
+
+            template <std::floating_point T>
+            T scalar_kahan_sum(const T *data, std::size_t size, T sum = 0, T compensation = 0) noexcept
+            {
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    kahan_add(sum, compensation, data[i]);
+                }
+                return sum - compensation;
+            }
+
+            template <typename T>
+            std::pair<T, T> scalar_min_max(const T *data, std::size_t size) noexcept
+            {
+                T lo = data[0];
+                T hi = data[0];
+                for (std::size_t i = 1; i < size; ++i)
+                {
+                    lo = std::min(lo, data[i]);
+                    hi = std::max(hi, data[i]);
+                }
+                return {lo, hi};
+            }
+
+#if defined(ASYNCPP_SIMD_X86)
+            struct avx2_f32
+            {
+                using value_type = float;
+                using vector_type = __m256;
+                static constexpr std::size_t width = 8;
+
+                ASYNCPP_TARGET_AVX2 static __m256 load(const float *p) noexcept { return _mm256_loadu_ps(p); }
+                ASYNCPP_TARGET_AVX2 static void store(float *p, __m256 v) noexcept { _mm256_storeu_ps(p, v); }
+                ASYNCPP_TARGET_AVX2 static __m256 zero() noexcept { return _mm256_setzero_ps(); }
+                ASYNCPP_TARGET_AVX2 static __m256 add(__m256 a, __m256 b) noexcept { return _mm256_add_ps(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256 sub(__m256 a, __m256 b) noexcept { return _mm256_sub_ps(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256 min(__m256 a, __m256 b) noexcept { return _mm256_min_ps(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256 max(__m256 a, __m256 b) noexcept { return _mm256_max_ps(a, b); }
+            };
+
+            struct avx2_f64
+            {
+                using value_type = double;
+                using vector_type = __m256d;
+                static constexpr std::size_t width = 4;
+
+                ASYNCPP_TARGET_AVX2 static __m256d load(const double *p) noexcept { return _mm256_loadu_pd(p); }
+                ASYNCPP_TARGET_AVX2 static void store(double *p, __m256d v) noexcept { _mm256_storeu_pd(p, v); }
+                ASYNCPP_TARGET_AVX2 static __m256d zero() noexcept { return _mm256_setzero_pd(); }
+                ASYNCPP_TARGET_AVX2 static __m256d add(__m256d a, __m256d b) noexcept { return _mm256_add_pd(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256d sub(__m256d a, __m256d b) noexcept { return _mm256_sub_pd(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256d min(__m256d a, __m256d b) noexcept { return _mm256_min_pd(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256d max(__m256d a, __m256d b) noexcept { return _mm256_max_pd(a, b); }
+            };
+
+            struct avx2_i32
+            {
+                using value_type = std::int32_t;
+                using vector_type = __m256i;
+                static constexpr std::size_t width = 8;
+
+                ASYNCPP_TARGET_AVX2 static __m256i load(const std::int32_t *p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+                ASYNCPP_TARGET_AVX2 static void store(std::int32_t *p, __m256i v) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+                ASYNCPP_TARGET_AVX2 static __m256i min(__m256i a, __m256i b) noexcept { return _mm256_min_epi32(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256i max(__m256i a, __m256i b) noexcept { return _mm256_max_epi32(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256i widen(__m128i v) noexcept { return _mm256_cvtepi32_epi64(v); }
+            };
+
+            struct avx2_u32
+            {
+                using value_type = std::uint32_t;
+                using vector_type = __m256i;
+                static constexpr std::size_t width = 8;
+
+                ASYNCPP_TARGET_AVX2 static __m256i load(const std::uint32_t *p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+                ASYNCPP_TARGET_AVX2 static void store(std::uint32_t *p, __m256i v) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+                ASYNCPP_TARGET_AVX2 static __m256i min(__m256i a, __m256i b) noexcept { return _mm256_min_epu32(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256i max(__m256i a, __m256i b) noexcept { return _mm256_max_epu32(a, b); }
+                ASYNCPP_TARGET_AVX2 static __m256i widen(__m128i v) noexcept { return _mm256_cvtepu32_epi64(v); }
+            };
+
+            template <typename T>
+            struct avx2_ops
+            {
+            };
+
+            template <>
+            struct avx2_ops<float> : avx2_f32
+            {
+            };
+
+            template <>
+            struct avx2_ops<double> : avx2_f64
+            {
+            };
+
+            template <>
+            struct avx2_ops<std::int32_t> : avx2_i32
+            {
+            };
+
+            template <>
+            struct avx2_ops<std::uint32_t> : avx2_u32
+            {
+            };
+
+            template <typename T>
+            concept vectorized_float = std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+            template <typename T>
+            concept vectorized_integral = std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::uint32_t>;
+
+            template <vectorized_float T, typename Ops = avx2_ops<T>>
+            ASYNCPP_TARGET_AVX2 T avx2_sum(const T *data, std::size_t size) noexcept
+            {
+                auto acc0 = Ops::zero();
+                auto acc1 = Ops::zero();
+                std::size_t i = 0;
+                for (; i + 2 * Ops::width <= size; i += 2 * Ops::width)
+                {
+                    acc0 = Ops::add(acc0, Ops::load(data + i));
+                    acc1 = Ops::add(acc1, Ops::load(data + i + Ops::width));
+                }
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    acc0 = Ops::add(acc0, Ops::load(data + i));
+                }
+
+                T lanes[Ops::width];
+                Ops::store(lanes, Ops::add(acc0, acc1));
+                T result = 0;
+                for (auto lane : lanes)
+                {
+                    result += lane;
+                }
+                for (; i < size; ++i)
+                {
+                    result += data[i];
+                }
+                return result;
+            }
+
+            template <vectorized_float T, typename Ops = avx2_ops<T>>
+            ASYNCPP_TARGET_AVX2 T avx2_kahan_sum(const T *data, std::size_t size) noexcept
+            {
+                auto sum = Ops::zero();
+                auto compensation = Ops::zero();
+                std::size_t i = 0;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto y = Ops::sub(Ops::load(data + i), compensation);
+                    const auto t = Ops::add(sum, y);
+                    compensation = Ops::sub(Ops::sub(t, sum), y);
+                    sum = t;
+                }
+
+                // Fold the lanes together, carrying their compensations along.
+                T sums[Ops::width];
+                T compensations[Ops::width];
+                Ops::store(sums, sum);
+                Ops::store(compensations, compensation);
+                T total = 0;
+                T total_compensation = 0;
+                for (std::size_t j = 0; j < Ops::width; ++j)
+                {
+                    kahan_add(total, total_compensation, sums[j]);
+                    kahan_add(total, total_compensation, -compensations[j]);
+                }
+                return scalar_kahan_sum(data + i, size - i, total, total_compensation);
+            }
+
+            template <vectorized_integral T, typename Ops = avx2_ops<T>>
+            ASYNCPP_TARGET_AVX2 sum_t<T> avx2_widened_sum(const T *data, std::size_t size) noexcept
+            {
+                auto acc0 = _mm256_setzero_si256();
+                auto acc1 = _mm256_setzero_si256();
+                std::size_t i = 0;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto v = Ops::load(data + i);
+                    acc0 = _mm256_add_epi64(acc0, Ops::widen(_mm256_castsi256_si128(v)));
+                    acc1 = _mm256_add_epi64(acc1, Ops::widen(_mm256_extracti128_si256(v, 1)));
+                }
+
+                sum_t<T> lanes[4];
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+                sum_t<T> result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+                for (; i < size; ++i)
+                {
+                    result += data[i];
+                }
+                return result;
+            }
+
+            template <typename T, typename Ops = avx2_ops<T>>
+            ASYNCPP_TARGET_AVX2 std::pair<T, T> avx2_min_max(const T *data, std::size_t size) noexcept
+            {
+                if (size < Ops::width)
+                {
+                    return scalar_min_max(data, size);
+                }
+
+                auto lo = Ops::load(data);
+                auto hi = lo;
+                std::size_t i = Ops::width;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto v = Ops::load(data + i);
+                    lo = Ops::min(lo, v);
+                    hi = Ops::max(hi, v);
+                }
+
+                T lows[Ops::width];
+                T highs[Ops::width];
+                Ops::store(lows, lo);
+                Ops::store(highs, hi);
+                auto result = std::pair<T, T>(lows[0], highs[0]);
+                for (std::size_t j = 1; j < Ops::width; ++j)
+                {
+                    result.first = std::min(result.first, lows[j]);
+                    result.second = std::max(result.second, highs[j]);
+                }
+                for (; i < size; ++i)
+                {
+                    result.first = std::min(result.first, data[i]);
+                    result.second = std::max(result.second, data[i]);
+                }
+                return result;
+            }
+            struct sse41_f32
+            {
+                using value_type = float;
+                using vector_type = __m128;
+                static constexpr std::size_t width = 4;
+
+                ASYNCPP_TARGET_SSE41 static __m128 load(const float *p) noexcept { return _mm_loadu_ps(p); }
+                ASYNCPP_TARGET_SSE41 static void store(float *p, __m128 v) noexcept { _mm_storeu_ps(p, v); }
+                ASYNCPP_TARGET_SSE41 static __m128 zero() noexcept { return _mm_setzero_ps(); }
+                ASYNCPP_TARGET_SSE41 static __m128 add(__m128 a, __m128 b) noexcept { return _mm_add_ps(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128 sub(__m128 a, __m128 b) noexcept { return _mm_sub_ps(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128 min(__m128 a, __m128 b) noexcept { return _mm_min_ps(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128 max(__m128 a, __m128 b) noexcept { return _mm_max_ps(a, b); }
+            };
+
+            struct sse41_f64
+            {
+                using value_type = double;
+                using vector_type = __m128d;
+                static constexpr std::size_t width = 2;
+
+                ASYNCPP_TARGET_SSE41 static __m128d load(const double *p) noexcept { return _mm_loadu_pd(p); }
+                ASYNCPP_TARGET_SSE41 static void store(double *p, __m128d v) noexcept { _mm_storeu_pd(p, v); }
+                ASYNCPP_TARGET_SSE41 static __m128d zero() noexcept { return _mm_setzero_pd(); }
+                ASYNCPP_TARGET_SSE41 static __m128d add(__m128d a, __m128d b) noexcept { return _mm_add_pd(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128d sub(__m128d a, __m128d b) noexcept { return _mm_sub_pd(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128d min(__m128d a, __m128d b) noexcept { return _mm_min_pd(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128d max(__m128d a, __m128d b) noexcept { return _mm_max_pd(a, b); }
+            };
+
+            struct sse41_i32
+            {
+                using value_type = std::int32_t;
+                using vector_type = __m128i;
+                static constexpr std::size_t width = 4;
+
+                ASYNCPP_TARGET_SSE41 static __m128i load(const std::int32_t *p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+                ASYNCPP_TARGET_SSE41 static void store(std::int32_t *p, __m128i v) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+                ASYNCPP_TARGET_SSE41 static __m128i min(__m128i a, __m128i b) noexcept { return _mm_min_epi32(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128i max(__m128i a, __m128i b) noexcept { return _mm_max_epi32(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128i widen(__m128i v) noexcept { return _mm_cvtepi32_epi64(v); }
+            };
+
+            struct sse41_u32
+            {
+                using value_type = std::uint32_t;
+                using vector_type = __m128i;
+                static constexpr std::size_t width = 4;
+
+                ASYNCPP_TARGET_SSE41 static __m128i load(const std::uint32_t *p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+                ASYNCPP_TARGET_SSE41 static void store(std::uint32_t *p, __m128i v) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+                ASYNCPP_TARGET_SSE41 static __m128i min(__m128i a, __m128i b) noexcept { return _mm_min_epu32(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128i max(__m128i a, __m128i b) noexcept { return _mm_max_epu32(a, b); }
+                ASYNCPP_TARGET_SSE41 static __m128i widen(__m128i v) noexcept { return _mm_cvtepu32_epi64(v); }
+            };
+
+            template <typename T>
+            struct sse41_ops
+            {
+            };
+
+            template <>
+            struct sse41_ops<float> : sse41_f32
+            {
+            };
+
+            template <>
+            struct sse41_ops<double> : sse41_f64
+            {
+            };
+
+            template <>
+            struct sse41_ops<std::int32_t> : sse41_i32
+            {
+            };
+
+            template <>
+            struct sse41_ops<std::uint32_t> : sse41_u32
+            {
+            };
+
+            // The 128 bit kernels mirror the AVX2 ones, they cannot share code because the target attribute
+            // decides which instruction encoding the compiler may emit.
+            template <vectorized_float T, typename Ops = sse41_ops<T>>
+            ASYNCPP_TARGET_SSE41 T sse41_sum(const T *data, std::size_t size) noexcept
+            {
+                auto acc0 = Ops::zero();
+                auto acc1 = Ops::zero();
+                std::size_t i = 0;
+                for (; i + 2 * Ops::width <= size; i += 2 * Ops::width)
+                {
+                    acc0 = Ops::add(acc0, Ops::load(data + i));
+                    acc1 = Ops::add(acc1, Ops::load(data + i + Ops::width));
+                }
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    acc0 = Ops::add(acc0, Ops::load(data + i));
+                }
+
+                T lanes[Ops::width];
+                Ops::store(lanes, Ops::add(acc0, acc1));
+                T result = 0;
+                for (auto lane : lanes)
+                {
+                    result += lane;
+                }
+                for (; i < size; ++i)
+                {
+                    result += data[i];
+                }
+                return result;
+            }
+
+            template <vectorized_float T, typename Ops = sse41_ops<T>>
+            ASYNCPP_TARGET_SSE41 T sse41_kahan_sum(const T *data, std::size_t size) noexcept
+            {
+                auto sum = Ops::zero();
+                auto compensation = Ops::zero();
+                std::size_t i = 0;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto y = Ops::sub(Ops::load(data + i), compensation);
+                    const auto t = Ops::add(sum, y);
+                    compensation = Ops::sub(Ops::sub(t, sum), y);
+                    sum = t;
+                }
+
+                T sums[Ops::width];
+                T compensations[Ops::width];
+                Ops::store(sums, sum);
+                Ops::store(compensations, compensation);
+                T total = 0;
+                T total_compensation = 0;
+                for (std::size_t j = 0; j < Ops::width; ++j)
+                {
+                    kahan_add(total, total_compensation, sums[j]);
+                    kahan_add(total, total_compensation, -compensations[j]);
+                }
+                return scalar_kahan_sum(data + i, size - i, total, total_compensation);
+            }
+
+            template <vectorized_integral T, typename Ops = sse41_ops<T>>
+            ASYNCPP_TARGET_SSE41 sum_t<T> sse41_widened_sum(const T *data, std::size_t size) noexcept
+            {
+                auto acc0 = _mm_setzero_si128();
+                auto acc1 = _mm_setzero_si128();
+                std::size_t i = 0;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto v = Ops::load(data + i);
+                    acc0 = _mm_add_epi64(acc0, Ops::widen(v));
+                    acc1 = _mm_add_epi64(acc1, Ops::widen(_mm_unpackhi_epi64(v, v)));
+                }
+
+                sum_t<T> lanes[2];
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+                sum_t<T> result = lanes[0] + lanes[1];
+                for (; i < size; ++i)
+                {
+                    result += data[i];
+                }
+                return result;
+            }
+
+            template <typename T, typename Ops = sse41_ops<T>>
+            ASYNCPP_TARGET_SSE41 std::pair<T, T> sse41_min_max(const T *data, std::size_t size) noexcept
+            {
+                if (size < Ops::width)
+                {
+                    return scalar_min_max(data, size);
+                }
+
+                auto lo = Ops::load(data);
+                auto hi = lo;
+                std::size_t i = Ops::width;
+                for (; i + Ops::width <= size; i += Ops::width)
+                {
+                    const auto v = Ops::load(data + i);
+                    lo = Ops::min(lo, v);
+                    hi = Ops::max(hi, v);
+                }
+
+                T lows[Ops::width];
+                T highs[Ops::width];
+                Ops::store(lows, lo);
+                Ops::store(highs, hi);
+                auto result = std::pair<T, T>(lows[0], highs[0]);
+                for (std::size_t j = 1; j < Ops::width; ++j)
+                {
+                    result.first = std::min(result.first, lows[j]);
+                    result.second = std::max(result.second, highs[j]);
+                }
+                for (; i < size; ++i)
+                {
+                    result.first = std::min(result.first, data[i]);
+                    result.second = std::max(result.second, data[i]);
+                }
+                return result;
+            }
+#endif
+
+            template <typename T>
+            sum_t<T> naive_sum(const T *data, std::size_t size) noexcept
+            {
+#if defined(ASYNCPP_SIMD_X86)
+                if constexpr (vectorized_float<T> || vectorized_integral<T>)
+                {
+                    if (has_avx2())
+                    {
+                        if constexpr (vectorized_float<T>)
+                        {
+                            return avx2_sum(data, size);
+                        }
+                        else
+                        {
+                            return avx2_widened_sum(data, size);
+                        }
+                    }
+                    if (has_sse41())
+                    {
+                        if constexpr (vectorized_float<T>)
+                        {
+                            return sse41_sum(data, size);
+                        }
+                        else
+                        {
+                            return sse41_widened_sum(data, size);
+                        }
+                    }
+                }
+#endif
+                return scalar_sum(data, size);
+            }
+
+            template <std::floating_point T>
+            T pairwise_sum(const T *data, std::size_t size) noexcept
+            {
+                if (size <= pairwise_block)
+                {
+                    return naive_sum(data, size);
+                }
+
+                const auto half = size / 2;
+                return pairwise_sum(data, half) + pairwise_sum(data + half, size - half);
+            }
+
+            template <std::floating_point T>
+            T kahan_sum(const T *data, std::size_t size) noexcept
+            {
+#if defined(ASYNCPP_SIMD_X86)
+                if constexpr (vectorized_float<T>)
+                {
+                    if (has_avx2())
+                    {
+                        return avx2_kahan_sum(data, size);
+                    }
+                    if (has_sse41())
+                    {
+                        return sse41_kahan_sum(data, size);
+                    }
+                }
+#endif
+                return scalar_kahan_sum(data, size);
+            }
+        }
+
+        /**
+         * @brief Sums the values, throwing std::overflow_error if an integral sum does not fit in sum_t<T>.
+         */
+        template <typename T>
+            requires std::is_arithmetic_v<T>
+        sum_t<T> sum(std::span<const T> values, summation mode = summation::pairwise)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                switch (mode)
+                {
+                case summation::naive:
+                    return detail::naive_sum(values.data(), values.size());
+                case summation::kahan:
+                    return detail::kahan_sum(values.data(), values.size());
+                default:
+                    return detail::pairwise_sum(values.data(), values.size());
+                }
+            }
+            else if constexpr (sizeof(T) < sizeof(sum_t<T>))
+            {
+                sum_t<T> result = 0;
+                for (std::size_t i = 0; i < values.size(); i += detail::widened_chunk)
+                {
+                    auto size = std::min(detail::widened_chunk, values.size() - i);
+                    result = checked_add(result, detail::naive_sum(values.data() + i, size));
+                }
+                return result;
+            }
+            else
+            {
+                sum_t<T> result = 0;
+                for (auto value : values)
+                {
+                    result = checked_add(result, static_cast<sum_t<T>>(value));
+                }
+                return result;
+            }
+        }
+
+        /**
+         * @brief Returns the smallest and largest value, values must not be empty.
+         */
+        template <typename T>
+            requires std::is_arithmetic_v<T>
+        std::pair<T, T> min_max(std::span<const T> values) noexcept
+        {
+#if defined(ASYNCPP_SIMD_X86)
+            if constexpr (detail::vectorized_float<T> || detail::vectorized_integral<T>)
+            {
+                if (has_avx2())
+                {
+                    return detail::avx2_min_max(values.data(), values.size());
+                }
+                if (has_sse41())
+                {
+                    return detail::sse41_min_max(values.data(), values.size());
+                }
+            }
+#endif
+            return detail::scalar_min_max(values.data(), values.size());
+        }
+
+        template <typename T>
+        std::size_t count_if(std::span<const T> values, std::predicate<const T &> auto &&pred)
+        {
+            // Branchless so simple predicates vectorize once inlined.
+            std::size_t result = 0;
+            for (const auto &value : values)
+            {
+                result += pred(value) ? 1 : 0;
+            }
+            return result;
+        }
+    }
+}
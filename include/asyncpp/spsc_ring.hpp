@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include "cache_line.hpp"
+
+namespace async
+{
+    /**
+     * @brief A fixed size single producer single consumer ring which parks either side while it has to wait.
+     *
+     * Closing the ring wakes both sides, push fails from then on and pop drains what is left.
+     */
+    template <typename T>
+    class spsc_ring
+    {
+    public:
+        spsc_ring(std::size_t capacity)
+            : _slots(std::make_unique<std::optional<T>[]>(std::bit_ceil(std::max<std::size_t>(capacity, 1)))),
+              _mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1)
+        {
+        }
+
+        bool push(T &&item)
+        {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            while (tail - _cached_head > _mask)
+            {
+                _cached_head = _head.load(std::memory_order_acquire);
+                if (tail - _cached_head <= _mask)
+                {
+                    break;
+                }
+
+                if (!_wait(_producer_waiting, _producer_epoch, [&]
+                           { return tail - _head.load() <= _mask; }))
+                {
+                    return false;
+                }
+            }
+
+            if (_closed.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            _slots[tail & _mask].emplace(std::move(item));
+            _tail.store(tail + 1);
+            _notify(_consumer_waiting, _consumer_epoch);
+            return true;
+        }
+
+        std::optional<T> pop()
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            while (head == _cached_tail)
+            {
+                _cached_tail = _tail.load(std::memory_order_acquire);
+                if (head != _cached_tail)
+                {
+                    break;
+                }
+
+                if (!_wait(_consumer_waiting, _consumer_epoch, [&]
+                           { return head != _tail.load(); }))
+                {
+                    // Closed, but the producer may have published more before closing.
+                    _cached_tail = _tail.load(std::memory_order_acquire);
+                    if (head == _cached_tail)
+                    {
+                        return std::nullopt;
+                    }
+                }
+            }
+
+            auto &slot = _slots[head & _mask];
+            std::optional<T> item(std::move(slot));
+            slot.reset();
+            _head.store(head + 1);
+            _notify(_producer_waiting, _producer_epoch);
+            return item;
+        }
+
+        void close() noexcept
+        {
+            _closed.store(true);
+            _producer_epoch.fetch_add(1);
+            _producer_epoch.notify_all();
+            _consumer_epoch.fetch_add(1);
+            _consumer_epoch.notify_all();
+        }
+
+        bool closed() const noexcept
+        {
+            return _closed.load();
+        }
+
+    private:
+        std::unique_ptr<std::optional<T>[]> _slots;
+        const std::size_t _mask;
+        std::atomic<bool> _closed{false};
+
+        alignas(cache_line_size) std::atomic<std::size_t> _head{0};
+        std::size_t _cached_tail = 0;
+        std::atomic<bool> _consumer_waiting{false};
+        std::atomic<std::uint32_t> _consumer_epoch{0};
+
+        alignas(cache_line_size) std::atomic<std::size_t> _tail{0};
+        std::size_t _cached_head = 0;
+        std::atomic<bool> _producer_waiting{false};
+        std::atomic<std::uint32_t> _producer_epoch{0};
+
+        // Returns false when woken up by close, the other side only pays for a notify while someone is parked.
+        bool _wait(std::atomic<bool> &waiting, std::atomic<std::uint32_t> &epoch, auto &&ready)
+        {
+            const auto observed = epoch.load();
+            waiting.store(true);
+            if (!ready() && !_closed.load())
+            {
+                epoch.wait(observed);
+            }
+            waiting.store(false);
+            return !_closed.load() || ready();
+        }
+
+        void _notify(std::atomic<bool> &waiting, std::atomic<std::uint32_t> &epoch) noexcept
+        {
+            if (waiting.load())
+            {
+                epoch.fetch_add(1);
+                epoch.notify_one();
+            }
+        }
+    };
+}
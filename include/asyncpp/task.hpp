@@ -1,8 +1,10 @@
 #pragma once
 #include <exception>
 #include <coroutine>
+#include <ranges>
 #include <thread>
 #include <semaphore>
+#include <utility>
 #include "aggregate_exception.hpp"
 
 namespace async
@@ -0,0 +1,162 @@
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <asyncpp/bounded_queue.hpp>
+#include "check.hpp"
+#include "throwing_output.hpp"
+
+namespace
+{
+    std::string long_string(std::size_t i)
+    {
+        // Long enough to live on the heap, an overwritten element shows up as a leak or double free.
+        return std::string(64, static_cast<char>('a' + i % 26));
+    }
+
+    bool rejects_capacity(std::size_t capacity)
+    {
+        try
+        {
+            async::bounded_queue<std::string> q(capacity);
+        }
+        catch (const std::invalid_argument &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void rejects_capacity_below_two()
+    {
+        ASYNCPP_CHECK(rejects_capacity(0));
+        ASYNCPP_CHECK(rejects_capacity(1));
+        ASYNCPP_CHECK(!rejects_capacity(2));
+    }
+
+    template <typename Queue>
+    void two_slots_wrap(Queue &q)
+    {
+        // Fill and drain over many laps, a full ring must never be mistaken for an empty one.
+        for (std::size_t lap = 0; lap < 100; ++lap)
+        {
+            ASYNCPP_CHECK(q.try_push(long_string(2 * lap)));
+            ASYNCPP_CHECK(q.try_push(long_string(2 * lap + 1)));
+            ASYNCPP_CHECK(!q.try_push(long_string(0)));
+            ASYNCPP_CHECK(q.size() == 2);
+
+            auto first = q.try_pop();
+            ASYNCPP_CHECK(first && *first == long_string(2 * lap));
+            ASYNCPP_CHECK(q.try_push(long_string(2 * lap + 2)));
+            auto second = q.try_pop();
+            auto third = q.try_pop();
+            ASYNCPP_CHECK(second && *second == long_string(2 * lap + 1));
+            ASYNCPP_CHECK(third && *third == long_string(2 * lap + 2));
+            ASYNCPP_CHECK(!q.try_pop());
+        }
+    }
+
+    void capacity_two()
+    {
+        async::bounded_queue<std::string, 2> fixed;
+        two_slots_wrap(fixed);
+
+        async::bounded_queue<std::string> runtime(2);
+        two_slots_wrap(runtime);
+    }
+
+    struct throwing_move
+    {
+        std::string value;
+
+        explicit throwing_move(std::string v) : value(std::move(v)) {}
+
+        throwing_move(const throwing_move &) = default;
+
+        // Not noexcept, so pushes build the element in a temporary before claiming a slot.
+        throwing_move(throwing_move &&other) : value(std::move(other.value)) {}
+
+        throwing_move &operator=(const throwing_move &) = default;
+
+        throwing_move &operator=(throwing_move &&) = default;
+    };
+
+    void failed_push_leaves_argument_untouched()
+    {
+        async::bounded_queue<std::string> strings(2);
+        ASYNCPP_CHECK(strings.try_push(long_string(0)));
+        ASYNCPP_CHECK(strings.try_push(long_string(1)));
+        auto rejected = long_string(2);
+        ASYNCPP_CHECK(!strings.try_push(std::move(rejected)));
+        ASYNCPP_CHECK(rejected == long_string(2));
+        ASYNCPP_CHECK(!strings.try_emplace(std::move(rejected)));
+        ASYNCPP_CHECK(rejected == long_string(2));
+
+        async::bounded_queue<throwing_move, 2> elements;
+        ASYNCPP_CHECK(elements.try_push(throwing_move(long_string(0))));
+        ASYNCPP_CHECK(elements.try_push(throwing_move(long_string(1))));
+        throwing_move element(long_string(2));
+        ASYNCPP_CHECK(!elements.try_push(std::move(element)));
+        ASYNCPP_CHECK(element.value == long_string(2));
+        ASYNCPP_CHECK(!elements.try_emplace(std::move(element)));
+        ASYNCPP_CHECK(element.value == long_string(2));
+
+        // Once there is room the element is moved in.
+        ASYNCPP_CHECK(elements.try_pop());
+        ASYNCPP_CHECK(elements.try_push(std::move(element)));
+        ASYNCPP_CHECK(elements.try_pop()->value == long_string(1));
+        ASYNCPP_CHECK(elements.try_pop()->value == long_string(2));
+    }
+
+    void bulk_operations()
+    {
+        async::bounded_queue<std::string> q(8);
+        std::vector<std::string> items;
+        for (std::size_t i = 0; i < 10; ++i)
+        {
+            items.push_back(long_string(i));
+        }
+
+        // Only 8 fit, push_range returns the first element left over.
+        auto rest = q.push_range(items.begin(), items.end());
+        ASYNCPP_CHECK(rest == items.begin() + 8);
+
+        std::vector<std::string> out;
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 3) == 3);
+        ASYNCPP_CHECK(q.push_range(rest, items.end()) == items.end());
+
+        // Writing the third element throws, the claimed slots after it are destroyed and handed back.
+        out.clear();
+        bool threw = false;
+        try
+        {
+            q.try_pop_bulk(throwing_output<std::string>(out, 2), 5);
+        }
+        catch (const std::length_error &)
+        {
+            threw = true;
+        }
+        ASYNCPP_CHECK(threw);
+        ASYNCPP_CHECK(out.size() == 2 && out[1] == long_string(4));
+        ASYNCPP_CHECK(q.size() == 2);
+
+        // Producers can use every released slot again.
+        for (std::size_t i = 0; i < 6; ++i)
+        {
+            ASYNCPP_CHECK(q.try_push(long_string(i)));
+        }
+        ASYNCPP_CHECK(!q.try_push(long_string(0)));
+        out.clear();
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 10) == 8);
+        ASYNCPP_CHECK(out.front() == long_string(8));
+    }
+}
+
+int main()
+{
+    rejects_capacity_below_two();
+    capacity_two();
+    bulk_operations();
+    failed_push_leaves_argument_untouched();
+}
@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <asyncpp/broadcast_ring.hpp>
+#include "check.hpp"
+
+namespace
+{
+    void slowest_consumer_gates_producer()
+    {
+        async::broadcast_ring<int> ring(4);
+        auto fast = ring.subscribe();
+        auto slow = ring.subscribe();
+        for (int i = 0; i < 4; ++i)
+        {
+            ASYNCPP_CHECK(ring.try_push(i));
+        }
+        ASYNCPP_CHECK(!ring.try_push(4));
+
+        // Both consumers see every element, the producer waits for the slower one.
+        std::vector<int> seen;
+        ASYNCPP_CHECK(fast.poll([&](const int &v)
+                                { seen.push_back(v); }) == 4);
+        ASYNCPP_CHECK((seen == std::vector<int>{0, 1, 2, 3}));
+        ASYNCPP_CHECK(!ring.try_push(4));
+
+        ASYNCPP_CHECK(slow.poll([](const int &) {}, 2) == 2);
+        ASYNCPP_CHECK(ring.try_push(4));
+        ASYNCPP_CHECK(ring.try_push(5));
+        ASYNCPP_CHECK(!ring.try_push(6));
+
+        // Unsubscribing the slow consumer no longer holds the producer back.
+        {
+            auto gone = std::move(slow);
+        }
+        ASYNCPP_CHECK(fast.poll([](const int &) {}) == 2);
+        ASYNCPP_CHECK(ring.try_push(6));
+    }
+
+    void late_subscriber_starts_at_the_end()
+    {
+        async::broadcast_ring<int> ring(8);
+        auto early = ring.subscribe();
+        ring.push(1);
+        auto late = ring.subscribe();
+        ring.push(2);
+
+        std::vector<int> seen;
+        late.poll([&](const int &v)
+                  { seen.push_back(v); });
+        ASYNCPP_CHECK((seen == std::vector<int>{2}));
+        ASYNCPP_CHECK(early.poll([](const int &) {}) == 2);
+    }
+
+    void close_drains_and_rejects()
+    {
+        async::broadcast_ring<int> ring(4);
+        auto c = ring.subscribe();
+        ASYNCPP_CHECK(ring.push(1));
+        ring.close();
+        ASYNCPP_CHECK(!ring.push(2));
+        ASYNCPP_CHECK(!ring.try_push(2));
+
+        int sum = 0;
+        ASYNCPP_CHECK(c.read([&](const int &v)
+                             { sum += v; }) == 1);
+        ASYNCPP_CHECK(sum == 1);
+        ASYNCPP_CHECK(c.read([](const int &) {}) == 0);
+    }
+
+    void consumers_read_everything_in_order()
+    {
+        // A small ring keeps the producer waiting on the consumers and the consumers waiting on the producer.
+        constexpr std::uint64_t items = 50000;
+        constexpr std::size_t consumer_count = 3;
+        async::broadcast_ring<std::uint64_t> ring(16);
+        std::vector<async::broadcast_ring<std::uint64_t>::consumer> consumers;
+        for (std::size_t i = 0; i < consumer_count; ++i)
+        {
+            consumers.push_back(ring.subscribe());
+        }
+
+        std::vector<std::thread> threads;
+        std::vector<std::uint64_t> counts(consumer_count);
+        for (std::size_t i = 0; i < consumer_count; ++i)
+        {
+            threads.emplace_back([&, i]
+                                 {
+                                     std::uint64_t expected = 0;
+                                     while (consumers[i].read([&](const std::uint64_t &v)
+                                                              {
+                                                                  ASYNCPP_CHECK(v == expected);
+                                                                  ++expected; }) > 0)
+                                     {
+                                     }
+                                     counts[i] = expected; });
+        }
+        for (std::uint64_t i = 0; i < items; ++i)
+        {
+            ASYNCPP_CHECK(ring.push(i));
+        }
+        ring.close();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (auto count : counts)
+        {
+            ASYNCPP_CHECK(count == items);
+        }
+    }
+}
+
+int main()
+{
+    slowest_consumer_gates_producer();
+    late_subscriber_starts_at_the_end();
+    close_drains_and_rejects();
+    consumers_read_everything_in_order();
+}
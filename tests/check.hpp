@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * @brief Like assert, but also checked in release builds, a failure prints the condition and exits with an error.
+ */
+#define ASYNCPP_CHECK(condition)                                                                 \
+    do                                                                                           \
+    {                                                                                            \
+        if (!(condition))                                                                        \
+        {                                                                                        \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(EXIT_FAILURE);                                                             \
+        }                                                                                        \
+    } while (false)
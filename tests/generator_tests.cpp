@@ -0,0 +1,130 @@
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <asyncpp/batch_generator.hpp>
+#include <asyncpp/generator.hpp>
+#include "check.hpp"
+
+namespace
+{
+    async::generator<float> repeat(float value, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            co_yield value;
+        }
+    }
+
+    void pairwise_sum_spans_blocks()
+    {
+        // Naive summation of the block sums drifts by about 1e-4 here, a cascade stays within float rounding.
+        constexpr std::size_t count = std::size_t(1) << 24;
+        const double exact = static_cast<double>(0.1f) * count;
+        for (auto mode : {async::summation::pairwise, async::summation::kahan})
+        {
+            const double sum = repeat(0.1f, count).sum(mode);
+            ASYNCPP_CHECK(std::abs(sum - exact) / exact < 1e-6);
+        }
+    }
+
+    template <typename Generator>
+    bool throws_out_of_range(Generator &&gen)
+    {
+        try
+        {
+            gen.last();
+        }
+        catch (const std::out_of_range &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void last_of_contiguous_source()
+    {
+        ASYNCPP_CHECK(async::generator<std::string>(std::vector<std::string>{"first", "second"}).last() == "second");
+
+        const std::vector<std::string> borrowed{"first", "second"};
+        ASYNCPP_CHECK(async::generator<std::string>(borrowed).last() == "second");
+        ASYNCPP_CHECK(throws_out_of_range(async::generator<std::string>(std::vector<std::string>{})));
+    }
+
+    async::generator<std::string> long_strings(bool lvalues)
+    {
+        for (char c = 'a'; c <= 'c'; ++c)
+        {
+            // Long enough to live on the heap.
+            std::string value(64, c);
+            if (lvalues)
+            {
+                co_yield value;
+            }
+            else
+            {
+                co_yield std::move(value);
+            }
+        }
+    }
+
+    void last_of_coroutine()
+    {
+        ASYNCPP_CHECK(long_strings(true).last() == std::string(64, 'c'));
+        ASYNCPP_CHECK(long_strings(false).last() == std::string(64, 'c'));
+        ASYNCPP_CHECK(throws_out_of_range(repeat(1.0f, 0)));
+    }
+
+    async::generator<int> counted(int count, int &resumed)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            ++resumed;
+            co_yield i;
+        }
+    }
+
+    void zip_stops_at_shortest_source()
+    {
+        int short_resumed = 0;
+        int long_resumed = 0;
+        int pairs = 0;
+        for ([[maybe_unused]] auto &&_ : async::zip(counted(2, short_resumed), counted(5, long_resumed)))
+        {
+            ++pairs;
+        }
+        ASYNCPP_CHECK(pairs == 2);
+        ASYNCPP_CHECK(long_resumed == 2);
+
+        // A longer source in front is resumed once more before the shorter one is found to have ended.
+        short_resumed = 0;
+        long_resumed = 0;
+        ASYNCPP_CHECK(async::zip(counted(5, long_resumed), counted(2, short_resumed)).count() == 2);
+        ASYNCPP_CHECK(long_resumed == 3);
+
+        // An empty source in front means the others are never started.
+        long_resumed = 0;
+        ASYNCPP_CHECK(async::zip(counted(0, short_resumed), counted(5, long_resumed)).count() == 0);
+        ASYNCPP_CHECK(long_resumed == 0);
+    }
+
+    void external_sort_keeps_size_hint()
+    {
+        // A budget of two elements spills runs to disk, the merged output still has the size of the input.
+        auto sorted = async::generator<int>(std::vector<int>{5, 3, 9, 1, 7}).external_sort(std::less<>(), 2 * sizeof(int));
+        ASYNCPP_CHECK(sorted.size_hint() == std::optional<std::size_t>(5));
+        ASYNCPP_CHECK((sorted.to_vector() == std::vector<int>{1, 3, 5, 7, 9}));
+    }
+}
+
+int main()
+{
+    pairwise_sum_spans_blocks();
+    last_of_contiguous_source();
+    last_of_coroutine();
+    zip_stops_at_shortest_source();
+    external_sort_keeps_size_hint();
+}
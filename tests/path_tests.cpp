@@ -0,0 +1,100 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <asyncpp/fs/path.hpp>
+#include "check.hpp"
+
+namespace
+{
+    using path = async::fs::path<>;
+
+    void parses_components()
+    {
+        const path file("/usr/lib/libc.so.6");
+        ASYNCPP_CHECK(file.is_absolute());
+        ASYNCPP_CHECK(file.root_path() == "/");
+        ASYNCPP_CHECK(file.parent_path() == "/usr/lib");
+        ASYNCPP_CHECK(file.file_name() == "libc.so.6");
+        ASYNCPP_CHECK(file.stem() == "libc.so");
+        ASYNCPP_CHECK(file.extension() == "6");
+
+        // Without a directory the whole text is the file name.
+        const path relative("notes.txt");
+        ASYNCPP_CHECK(!relative.is_absolute());
+        ASYNCPP_CHECK(relative.root_path().empty());
+        ASYNCPP_CHECK(relative.parent_path().empty());
+        ASYNCPP_CHECK(relative.file_name() == "notes.txt");
+        ASYNCPP_CHECK(relative.stem() == "notes");
+        ASYNCPP_CHECK(relative.extension() == "txt");
+    }
+
+    void extension_edge_cases()
+    {
+        // A dot in a directory name does not start an extension of the file.
+        ASYNCPP_CHECK(path("conf.d/README").extension().empty());
+        ASYNCPP_CHECK(path("conf.d/README").stem() == "README");
+        ASYNCPP_CHECK(path("Makefile").stem() == "Makefile");
+
+        // Dot files and the special directories have no extension.
+        ASYNCPP_CHECK(path("/home/user/.profile").extension().empty());
+        ASYNCPP_CHECK(path("/home/user/.profile").stem() == ".profile");
+        ASYNCPP_CHECK(path("..").extension().empty());
+        ASYNCPP_CHECK(path("a/..").stem() == "..");
+        ASYNCPP_CHECK(path("archive.tar.").extension().empty());
+        ASYNCPP_CHECK(path("archive.tar.").stem() == "archive.tar");
+
+        ASYNCPP_CHECK(path("/").file_name().empty());
+        ASYNCPP_CHECK(path("/").root_path() == "/");
+        ASYNCPP_CHECK(path("").extension().empty());
+    }
+
+    void appends_components()
+    {
+        ASYNCPP_CHECK((path("/usr") / "lib").native() == "/usr/lib");
+        ASYNCPP_CHECK((path("/usr/") / "lib").native() == "/usr/lib");
+        ASYNCPP_CHECK((path("usr") / "lib" / "libc.so").native() == "usr/lib/libc.so");
+
+        // An absolute path replaces what it is appended to, appending to nothing keeps it relative.
+        ASYNCPP_CHECK((path("/usr") / "/etc").native() == "/etc");
+        ASYNCPP_CHECK((path() / "lib").native() == "lib");
+        ASYNCPP_CHECK((path("/usr") / "").native() == "/usr");
+
+        path p("/var");
+        p /= "log";
+        ASYNCPP_CHECK(p.native() == "/var/log" && p.file_name() == "log" && p.parent_path() == "/var");
+    }
+
+    void reads_and_walks_a_directory()
+    {
+        char pattern[] = "/tmp/asyncpp_path_XXXXXX";
+        ASYNCPP_CHECK(::mkdtemp(pattern) != nullptr);
+        const path directory{std::string(pattern)};
+        const auto file = directory / "data.bin";
+        const std::string contents(100000, 'x');
+        std::ofstream(file.native(), std::ios::binary) << contents;
+
+        ASYNCPP_CHECK(file.read_file_text() == contents);
+        ASYNCPP_CHECK(file.get_attributes().is_normal());
+        ASYNCPP_CHECK(directory.get_attributes().is_directory());
+
+        std::vector<std::string> names;
+        for (auto &&entry : directory.walk_directory())
+        {
+            names.push_back(entry.file_name());
+        }
+        ASYNCPP_CHECK((names == std::vector<std::string>{"data.bin"}));
+
+        ::unlink(file.native().c_str());
+        ::rmdir(directory.native().c_str());
+    }
+}
+
+int main()
+{
+    parses_components();
+    extension_edge_cases();
+    appends_components();
+    reads_and_walks_a_directory();
+}
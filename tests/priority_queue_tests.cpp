@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <asyncpp/priority_queue.hpp>
+#include "check.hpp"
+
+namespace
+{
+    void pops_every_element()
+    {
+        // The order is only close to the priorities, but nothing may be lost or duplicated.
+        async::priority_queue<int> q(4);
+        for (int i = 0; i < 1000; ++i)
+        {
+            q.push(i % 37, i);
+        }
+        ASYNCPP_CHECK(q.size() == 1000);
+
+        std::vector<int> popped;
+        while (auto item = q.try_pop())
+        {
+            popped.push_back(*item);
+        }
+        std::sort(popped.begin(), popped.end());
+        for (int i = 0; i < 1000; ++i)
+        {
+            ASYNCPP_CHECK(popped[i] == i);
+        }
+        ASYNCPP_CHECK(q.empty());
+    }
+
+    void size_stays_in_range_under_contention()
+    {
+        constexpr std::size_t threads_per_side = 4;
+        constexpr std::size_t items = 20000;
+        async::priority_queue<std::uint64_t> q(8);
+        std::atomic<bool> done = false;
+        std::atomic<std::uint64_t> sum = 0;
+        std::atomic<std::size_t> popped = 0;
+
+        // A size that wrapped below zero would show up as a huge value.
+        std::thread observer([&]
+                             {
+                                 while (!done.load())
+                                 {
+                                     ASYNCPP_CHECK(q.size() <= threads_per_side * items);
+                                 } });
+
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < threads_per_side; ++p)
+        {
+            threads.emplace_back([&, p]
+                                 {
+                                     for (std::uint64_t i = 0; i < items; ++i)
+                                     {
+                                         q.push(static_cast<int>(i % 100), p * items + i);
+                                     } });
+            threads.emplace_back([&]
+                                 {
+                                     while (popped.load() < threads_per_side * items)
+                                     {
+                                         if (auto item = q.try_pop())
+                                         {
+                                             sum.fetch_add(*item);
+                                             popped.fetch_add(1);
+                                         }
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        done.store(true);
+        observer.join();
+
+        const std::uint64_t total = threads_per_side * items;
+        ASYNCPP_CHECK(sum.load() == total * (total - 1) / 2);
+        ASYNCPP_CHECK(q.empty());
+    }
+
+    void blocking_pop()
+    {
+        async::priority_queue<int> q(4);
+        std::atomic<int> sum = 0;
+        std::thread consumer([&]
+                             {
+                                 for (int i = 0; i < 1000; ++i)
+                                 {
+                                     sum.fetch_add(q.pop());
+                                 } });
+        for (int i = 0; i < 1000; ++i)
+        {
+            q.push(i, i);
+        }
+        consumer.join();
+        ASYNCPP_CHECK(sum.load() == 999 * 1000 / 2);
+    }
+}
+
+int main()
+{
+    pops_every_element();
+    size_stays_in_range_under_contention();
+    blocking_pop();
+}
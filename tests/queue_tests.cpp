@@ -0,0 +1,531 @@
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <asyncpp/hazard_pointer.hpp>
+#include <asyncpp/queue.hpp>
+#include "check.hpp"
+#include "throwing_output.hpp"
+
+namespace
+{
+    struct tracked
+    {
+        std::atomic<bool> *destroyed;
+
+        ~tracked()
+        {
+            destroyed->store(true);
+        }
+    };
+
+    void retire_tracked(std::size_t count)
+    {
+        // Enough retirements to force at least one scan of the hazard records.
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            static std::atomic<bool> ignored;
+            async::retire(new tracked{&ignored});
+        }
+    }
+
+    void hazard_pointer_defers_reclamation()
+    {
+        std::atomic<bool> destroyed = false;
+        std::atomic<tracked *> shared = new tracked{&destroyed};
+        {
+            async::hazard_pointer hp;
+            auto protected_node = hp.protect(shared);
+            shared.store(nullptr);
+            async::retire(protected_node);
+            retire_tracked(1024);
+            ASYNCPP_CHECK(!destroyed.load());
+        }
+
+        retire_tracked(1024);
+        ASYNCPP_CHECK(destroyed.load());
+    }
+
+    void hazard_pointer_protects_across_threads()
+    {
+        // A pointer retired by another thread, which then exits, survives until the reader dropped it.
+        std::atomic<bool> destroyed = false;
+        std::atomic<tracked *> shared = new tracked{&destroyed};
+        async::hazard_pointer hp;
+        auto node = hp.protect(shared);
+        std::thread([&]
+                    {
+                        async::retire(shared.exchange(nullptr));
+                        retire_tracked(1024); })
+            .join();
+        ASYNCPP_CHECK(!destroyed.load());
+        ASYNCPP_CHECK(node->destroyed == &destroyed);
+
+        hp.reset();
+        retire_tracked(1024);
+        ASYNCPP_CHECK(destroyed.load());
+    }
+
+    struct throwing_copy
+    {
+        int value = 0;
+
+        explicit throwing_copy(int v) : value(v) {}
+
+        throwing_copy(const throwing_copy &other) : value(other.value)
+        {
+            if (value < 0)
+            {
+                throw std::runtime_error("copy");
+            }
+        }
+
+        throwing_copy(throwing_copy &&) noexcept = default;
+
+        throwing_copy &operator=(const throwing_copy &) = default;
+
+        throwing_copy &operator=(throwing_copy &&) noexcept = default;
+    };
+
+    void throwing_copy_leaves_queue_unchanged()
+    {
+        // Each failure would leave an unpublished slot behind if the copy ran into a claimed slot.
+        async::queue<throwing_copy, 4> q;
+        for (int i = 0; i < 10; ++i)
+        {
+            const throwing_copy good(i);
+            const throwing_copy bad(-1);
+            q.push(good);
+            bool threw = false;
+            try
+            {
+                q.push(bad);
+            }
+            catch (const std::runtime_error &)
+            {
+                threw = true;
+            }
+            ASYNCPP_CHECK(threw);
+        }
+
+        for (int i = 0; i < 10; ++i)
+        {
+            auto item = q.try_pop();
+            ASYNCPP_CHECK(item && item->value == i);
+        }
+        ASYNCPP_CHECK(!q.try_pop());
+    }
+
+    template <typename Queue>
+    void bulk_spans_segments()
+    {
+        // 10 elements over segments of 4: one push_range and one try_pop_bulk each have to cross segments.
+        Queue q;
+        std::vector<std::string> items;
+        for (int i = 0; i < 10; ++i)
+        {
+            items.push_back(std::string(64, static_cast<char>('a' + i)));
+        }
+        q.push_range(items.begin(), items.end());
+        ASYNCPP_CHECK(q.size() == 10);
+
+        std::vector<std::string> out;
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 7) == 7);
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 7) == 3);
+        ASYNCPP_CHECK(out == items);
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 7) == 0);
+
+        // A moved range leaves the sources empty.
+        q.push_range(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        ASYNCPP_CHECK(items.front().empty());
+        out.clear();
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 10) == 10);
+        ASYNCPP_CHECK(out.back() == std::string(64, 'j'));
+    }
+
+    template <typename Queue>
+    void throwing_output_keeps_queue_usable()
+    {
+        Queue q;
+        for (int i = 0; i < 10; ++i)
+        {
+            q.push(std::string(64, static_cast<char>('a' + i)));
+        }
+
+        // The first segment's run of 4 is claimed, two are written, the other two are destroyed.
+        std::vector<std::string> out;
+        bool threw = false;
+        try
+        {
+            q.try_pop_bulk(throwing_output<std::string>(out, 2), 10);
+        }
+        catch (const std::length_error &)
+        {
+            threw = true;
+        }
+        ASYNCPP_CHECK(threw);
+        ASYNCPP_CHECK(out.size() == 2 && out[1] == std::string(64, 'b'));
+
+        auto next = q.try_pop();
+        ASYNCPP_CHECK(next && *next == std::string(64, 'e'));
+        q.push(std::string(64, 'k'));
+        out.clear();
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 10) == 6);
+        ASYNCPP_CHECK(out.back() == std::string(64, 'k'));
+    }
+
+    void bulk_operations()
+    {
+        using namespace async;
+        bulk_spans_segments<queue<std::string, 4, producers::single, consumers::single>>();
+        bulk_spans_segments<queue<std::string, 4, producers::multi, consumers::multi>>();
+        throwing_output_keeps_queue_usable<queue<std::string, 4, producers::single, consumers::single>>();
+        throwing_output_keeps_queue_usable<queue<std::string, 4, producers::multi, consumers::multi>>();
+    }
+
+    constexpr std::uint64_t waited_items = 5000;
+
+    constexpr std::uint64_t waited_sum = waited_items * (waited_items - 1) / 2;
+
+    template <typename Queue>
+    void blocking_pop(std::size_t consumers)
+    {
+        // Consumers start on an empty queue and park, the producer wakes them one element at a time.
+        Queue q;
+        std::atomic<std::uint64_t> sum = 0;
+        std::vector<std::thread> threads;
+        for (std::size_t c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&]
+                                 {
+                                     for (std::size_t i = 0; i < waited_items / consumers; ++i)
+                                     {
+                                         sum.fetch_add(q.pop());
+                                     } });
+        }
+        for (std::uint64_t i = 0; i < waited_items; ++i)
+        {
+            q.push(i);
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        ASYNCPP_CHECK(sum.load() == waited_sum);
+    }
+
+    /**
+     * @brief A coroutine that starts right away and frees itself when it finishes.
+     */
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    template <typename Queue>
+    detached consume(Queue &q, std::uint64_t count, std::atomic<std::uint64_t> &sum, std::atomic<std::size_t> &finished)
+    {
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            sum.fetch_add(co_await q.pop_async());
+        }
+        finished.fetch_add(1);
+    }
+
+    template <typename Queue>
+    void async_pop(std::size_t consumers)
+    {
+        // Every coroutine suspends on the empty queue and is resumed by the pushes on this thread.
+        Queue q;
+        std::atomic<std::uint64_t> sum = 0;
+        std::atomic<std::size_t> finished = 0;
+        for (std::size_t c = 0; c < consumers; ++c)
+        {
+            consume(q, waited_items / consumers, sum, finished);
+        }
+        for (std::uint64_t i = 0; i < waited_items; ++i)
+        {
+            q.push(i);
+        }
+
+        ASYNCPP_CHECK(finished.load() == consumers);
+        ASYNCPP_CHECK(sum.load() == waited_sum);
+        ASYNCPP_CHECK(q.empty());
+    }
+
+    template <typename Queue>
+    void async_pop_from_threads(std::size_t producers)
+    {
+        Queue q;
+        std::atomic<std::uint64_t> sum = 0;
+        std::atomic<std::size_t> finished = 0;
+        consume(q, waited_items, sum, finished);
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p]
+                                 {
+                                     for (std::uint64_t i = p; i < waited_items; i += producers)
+                                     {
+                                         q.push(i);
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        ASYNCPP_CHECK(finished.load() == 1);
+        ASYNCPP_CHECK(sum.load() == waited_sum);
+    }
+
+    void waiting_pops()
+    {
+        using namespace async;
+        blocking_pop<queue<std::uint64_t, 16, producers::single, consumers::single>>(1);
+        blocking_pop<queue<std::uint64_t, 16, producers::single, consumers::multi>>(4);
+        async_pop<queue<std::uint64_t, 16, producers::single, consumers::single>>(1);
+        async_pop<queue<std::uint64_t, 16, producers::single, consumers::multi>>(4);
+        async_pop_from_threads<queue<std::uint64_t, 16, producers::multi, consumers::single>>(4);
+    }
+
+    void metrics_track_depth()
+    {
+        async::queue<int, 16> q;
+        const auto start = q.metrics();
+        for (int i = 0; i < 40; ++i)
+        {
+            q.push(i);
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            q.try_pop();
+        }
+
+        const auto filled = q.metrics();
+        ASYNCPP_CHECK(filled.enqueued == 40 && filled.dequeued == 10);
+        ASYNCPP_CHECK(filled.size() == 30 && q.size() == 30);
+        // Sampled when a segment fills up, so only the depth at the second full segment is known for sure.
+        ASYNCPP_CHECK(filled.high_water_mark >= 32 && filled.high_water_mark <= 40);
+        ASYNCPP_CHECK(filled.enqueue_rate(start) >= 0.0);
+
+        while (q.try_pop())
+        {
+        }
+        const auto drained = q.metrics();
+        ASYNCPP_CHECK(q.empty() && drained.dequeued == 40);
+        ASYNCPP_CHECK(drained.high_water_mark >= filled.high_water_mark);
+    }
+
+    void water_marks_gate_try_push()
+    {
+        async::queue<int, 4> q(async::queue_budget::elements(8, 2));
+        for (int i = 0; i < 8; ++i)
+        {
+            ASYNCPP_CHECK(q.try_push(i));
+        }
+        ASYNCPP_CHECK(!q.try_push(8));
+
+        // Admission stays closed until the depth is back at the low water mark.
+        for (int i = 0; i < 5; ++i)
+        {
+            ASYNCPP_CHECK(q.try_pop());
+        }
+        ASYNCPP_CHECK(!q.try_push(8));
+        ASYNCPP_CHECK(q.try_pop());
+        ASYNCPP_CHECK(q.try_push(8));
+        ASYNCPP_CHECK(q.size() == 3);
+
+        // Bulk pops hand back their room the same way.
+        for (int i = 0; i < 5; ++i)
+        {
+            ASYNCPP_CHECK(q.try_push(i));
+        }
+        ASYNCPP_CHECK(!q.try_push(0));
+        std::vector<int> out;
+        ASYNCPP_CHECK(q.try_pop_bulk(std::back_inserter(out), 6) == 6);
+        ASYNCPP_CHECK(q.try_push(0));
+    }
+
+    void blocked_push_waits_for_low_water()
+    {
+        // The producer blocks at the high water mark, so the consumer never sees more than that queued.
+        constexpr int items = 20000;
+        async::queue<int, 8> q(async::queue_budget::elements(16, 4));
+        std::thread producer([&]
+                             {
+                                 for (int i = 0; i < items; ++i)
+                                 {
+                                     q.push(i);
+                                 } });
+
+        long long sum = 0;
+        for (int i = 0; i < items; ++i)
+        {
+            ASYNCPP_CHECK(q.size() <= 16);
+            sum += q.pop();
+        }
+        producer.join();
+        ASYNCPP_CHECK(sum == static_cast<long long>(items) * (items - 1) / 2);
+    }
+
+    template <typename Queue>
+    detached produce(Queue &q, int count, std::atomic<std::size_t> &finished)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            co_await q.push_async(i);
+        }
+        finished.fetch_add(1);
+    }
+
+    void push_async_resumes_on_drain()
+    {
+        // Three coroutines suspend once the queue holds 8, the pop reaching the low water mark resumes them here.
+        async::queue<int, 4> q(async::queue_budget::elements(8, 2));
+        std::atomic<std::size_t> finished = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            produce(q, 100, finished);
+        }
+        ASYNCPP_CHECK(finished.load() == 0);
+        ASYNCPP_CHECK(q.size() == 8);
+
+        int popped = 0;
+        while (auto item = q.try_pop())
+        {
+            ++popped;
+        }
+        ASYNCPP_CHECK(popped == 300);
+        ASYNCPP_CHECK(finished.load() == 3);
+    }
+
+    void async_producers_and_consumers_under_stress()
+    {
+        // Both sides suspend: producers on a full budget, consumers on an empty queue, driven from four threads.
+        constexpr int items = 2000;
+        async::queue<std::uint64_t, 8> q(async::queue_budget::elements(16, 4));
+        std::atomic<std::uint64_t> sum = 0;
+        std::atomic<std::size_t> produced = 0;
+        std::atomic<std::size_t> consumed = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; ++t)
+        {
+            threads.emplace_back([&]
+                                 { consume(q, items, sum, consumed); });
+            threads.emplace_back([&]
+                                 { produce(q, items, produced); });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        while (produced.load() < 2 || consumed.load() < 2)
+        {
+            std::this_thread::yield();
+        }
+        ASYNCPP_CHECK(sum.load() == 2 * static_cast<std::uint64_t>(items) * (items - 1) / 2);
+        ASYNCPP_CHECK(q.empty());
+    }
+
+    void backpressure()
+    {
+        water_marks_gate_try_push();
+        blocked_push_waits_for_low_water();
+        push_async_resumes_on_drain();
+        async_producers_and_consumers_under_stress();
+    }
+
+    constexpr std::size_t stress_items = 20000;
+
+    /**
+     * @brief Pushes stress_items tagged elements from each producer and checks every consumer sees each producer's
+     * elements in order and, together, all of them exactly once.
+     */
+    template <typename Queue>
+    void stress(std::size_t producers, std::size_t consumers)
+    {
+        Queue q;
+        std::vector<std::atomic<std::size_t>> seen(producers * stress_items);
+        std::atomic<std::size_t> popped = 0;
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p]
+                                 {
+                                     for (std::size_t i = 0; i < stress_items; ++i)
+                                     {
+                                         q.push(static_cast<std::uint64_t>(p * stress_items + i));
+                                     } });
+        }
+        for (std::size_t c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&]
+                                 {
+                                     std::vector<std::size_t> last(producers, stress_items);
+                                     while (popped.load() < producers * stress_items)
+                                     {
+                                         auto item = q.try_pop();
+                                         if (!item)
+                                         {
+                                             std::this_thread::yield();
+                                             continue;
+                                         }
+
+                                         const auto producer = *item / stress_items;
+                                         const auto index = *item % stress_items;
+                                         ASYNCPP_CHECK(last[producer] == stress_items || last[producer] < index);
+                                         last[producer] = index;
+                                         seen[*item].fetch_add(1);
+                                         popped.fetch_add(1);
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (auto &count : seen)
+        {
+            ASYNCPP_CHECK(count.load() == 1);
+        }
+        ASYNCPP_CHECK(!q.try_pop());
+        ASYNCPP_CHECK(q.empty());
+    }
+
+    void policies_under_stress()
+    {
+        // Small segments so the run links, retires and recycles plenty of them.
+        using namespace async;
+        stress<queue<std::uint64_t, 16, producers::single, consumers::single>>(1, 1);
+        stress<queue<std::uint64_t, 16, producers::multi, consumers::single>>(4, 1);
+        stress<queue<std::uint64_t, 16, producers::single, consumers::multi>>(1, 4);
+        stress<queue<std::uint64_t, 16, producers::multi, consumers::multi>>(4, 4);
+    }
+}
+
+int main()
+{
+    hazard_pointer_defers_reclamation();
+    hazard_pointer_protects_across_threads();
+    throwing_copy_leaves_queue_unchanged();
+    policies_under_stress();
+    bulk_operations();
+    waiting_pops();
+    metrics_track_depth();
+    backpressure();
+}
@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <asyncpp/shm_bounded_queue.hpp>
+#include "check.hpp"
+
+namespace
+{
+    struct record
+    {
+        std::uint64_t sequence;
+        double value;
+    };
+
+    void small_capacities_round_up()
+    {
+        auto q = async::shm_bounded_queue<record>::create_anonymous(1);
+        ASYNCPP_CHECK(q.capacity() == 2);
+        for (std::uint64_t lap = 0; lap < 100; ++lap)
+        {
+            ASYNCPP_CHECK(q.try_push(record{2 * lap, 0.0}));
+            ASYNCPP_CHECK(q.try_push(record{2 * lap + 1, 0.0}));
+            ASYNCPP_CHECK(!q.try_push(record{0, 0.0}));
+            ASYNCPP_CHECK(q.try_pop()->sequence == 2 * lap);
+            ASYNCPP_CHECK(q.try_pop()->sequence == 2 * lap + 1);
+            ASYNCPP_CHECK(!q.try_pop());
+        }
+        ASYNCPP_CHECK(async::shm_bounded_queue<record>::create_anonymous(5).capacity() == 8);
+    }
+
+    void named_queue_is_shared()
+    {
+        const auto name = "/asyncpp_test_" + std::to_string(::getpid());
+        auto created = async::shm_bounded_queue<record>::create(name, 4);
+        auto opened = async::shm_bounded_queue<record>::open(name);
+        ASYNCPP_CHECK(created.try_push(record{7, 1.5}));
+        auto item = opened.try_pop();
+        ASYNCPP_CHECK(item && item->sequence == 7 && item->value == 1.5);
+
+        // A different element type is rejected instead of misreading the slots.
+        bool rejected = false;
+        try
+        {
+            async::shm_bounded_queue<std::uint32_t>::open(name);
+        }
+        catch (const std::runtime_error &)
+        {
+            rejected = true;
+        }
+        ASYNCPP_CHECK(rejected);
+        async::shm_bounded_queue<record>::unlink(name);
+    }
+
+    void exchanges_records_with_child_process()
+    {
+        // The child pops in order and reports a mismatch through its exit status, the small ring parks both sides.
+        constexpr std::uint64_t items = 20000;
+        auto q = async::shm_bounded_queue<record>::create_anonymous(8);
+        const auto child = ::fork();
+        ASYNCPP_CHECK(child >= 0);
+        if (child == 0)
+        {
+            for (std::uint64_t i = 0; i < items; ++i)
+            {
+                const auto item = q.pop();
+                if (item.sequence != i || item.value != static_cast<double>(i) / 2)
+                {
+                    ::_exit(1);
+                }
+            }
+            ::_exit(0);
+        }
+
+        for (std::uint64_t i = 0; i < items; ++i)
+        {
+            q.push(record{i, static_cast<double>(i) / 2});
+        }
+        int status = 0;
+        ASYNCPP_CHECK(::waitpid(child, &status, 0) == child);
+        ASYNCPP_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    void threads_share_a_mapping()
+    {
+        // Two mappings of the same memfd in one process, driven from several threads.
+        constexpr std::uint64_t items = 20000;
+        auto producer_side = async::shm_bounded_queue<record>::create_anonymous(16);
+        auto consumer_side = async::shm_bounded_queue<record>::from_fd(::dup(producer_side.fd()));
+        std::vector<std::thread> threads;
+        std::vector<std::uint64_t> sums(2);
+        for (std::uint64_t p = 0; p < 2; ++p)
+        {
+            threads.emplace_back([&, p]
+                                 {
+                                     for (std::uint64_t i = p; i < items; i += 2)
+                                     {
+                                         producer_side.push(record{i, 0.0});
+                                     } });
+            threads.emplace_back([&, p]
+                                 {
+                                     for (std::uint64_t i = 0; i < items / 2; ++i)
+                                     {
+                                         sums[p] += consumer_side.pop().sequence;
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        ASYNCPP_CHECK(sums[0] + sums[1] == items * (items - 1) / 2);
+        ASYNCPP_CHECK(consumer_side.size() == 0);
+    }
+}
+
+int main()
+{
+    small_capacities_round_up();
+    named_queue_is_shared();
+    exchanges_records_with_child_process();
+    threads_share_a_mapping();
+}
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include <asyncpp/simd.hpp>
+#include "check.hpp"
+
+namespace
+{
+    template <typename T>
+    std::vector<T> ramp(std::size_t size)
+    {
+        // Odd sizes leave a scalar tail behind the vector loops, the sign flips keep min and max away from the ends.
+        std::vector<T> values(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            const auto magnitude = static_cast<T>((i * 37) % 101);
+            values[i] = std::is_signed_v<T> && i % 3 == 0 ? static_cast<T>(-magnitude) : magnitude;
+        }
+        return values;
+    }
+
+    template <typename T>
+    void kernels_match_scalar()
+    {
+        using namespace async::simd::detail;
+        for (std::size_t size : {1, 3, 4, 7, 8, 9, 31, 1001})
+        {
+            const auto values = ramp<T>(size);
+            const auto expected_sum = scalar_sum(values.data(), size);
+            const auto expected_min_max = scalar_min_max(values.data(), size);
+            ASYNCPP_CHECK(async::simd::sum(std::span<const T>(values), async::summation::naive) == expected_sum);
+            ASYNCPP_CHECK(async::simd::min_max(std::span<const T>(values)) == expected_min_max);
+#if defined(ASYNCPP_SIMD_X86)
+            // The integral ramp sums exactly in floating point as well, so every kernel has to agree.
+            if (async::simd::has_sse41())
+            {
+                if constexpr (vectorized_float<T>)
+                {
+                    ASYNCPP_CHECK(sse41_sum(values.data(), size) == expected_sum);
+                    ASYNCPP_CHECK(sse41_kahan_sum(values.data(), size) == expected_sum);
+                }
+                else
+                {
+                    ASYNCPP_CHECK(sse41_widened_sum(values.data(), size) == expected_sum);
+                }
+                ASYNCPP_CHECK(sse41_min_max(values.data(), size) == expected_min_max);
+            }
+            if (async::simd::has_avx2())
+            {
+                if constexpr (vectorized_float<T>)
+                {
+                    ASYNCPP_CHECK(avx2_sum(values.data(), size) == expected_sum);
+                    ASYNCPP_CHECK(avx2_kahan_sum(values.data(), size) == expected_sum);
+                }
+                else
+                {
+                    ASYNCPP_CHECK(avx2_widened_sum(values.data(), size) == expected_sum);
+                }
+                ASYNCPP_CHECK(avx2_min_max(values.data(), size) == expected_min_max);
+            }
+#endif
+        }
+    }
+
+    void widened_sums_do_not_wrap()
+    {
+        const std::vector<std::uint32_t> values(1000, std::numeric_limits<std::uint32_t>::max());
+        ASYNCPP_CHECK(async::simd::sum(std::span<const std::uint32_t>(values)) ==
+                      std::uint64_t(1000) * std::numeric_limits<std::uint32_t>::max());
+    }
+}
+
+int main()
+{
+    kernels_match_scalar<float>();
+    kernels_match_scalar<double>();
+    kernels_match_scalar<std::int32_t>();
+    kernels_match_scalar<std::uint32_t>();
+    widened_sums_do_not_wrap();
+}
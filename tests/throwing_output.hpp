@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Appends to a vector like std::back_inserter, but throws std::length_error once it holds limit elements.
+ */
+template <typename T>
+class throwing_output
+{
+public:
+    using difference_type = std::ptrdiff_t;
+
+    class proxy
+    {
+    public:
+        explicit proxy(const throwing_output *it) noexcept : _it(it) {}
+
+        const proxy &operator=(T &&value) const
+        {
+            if (_it->_out->size() >= _it->_limit)
+            {
+                throw std::length_error("throwing_output");
+            }
+            _it->_out->push_back(std::move(value));
+            return *this;
+        }
+
+    private:
+        const throwing_output *_it;
+    };
+
+    throwing_output(std::vector<T> &out, std::size_t limit) noexcept : _out(&out), _limit(limit) {}
+
+    proxy operator*() const noexcept
+    {
+        return proxy(this);
+    }
+
+    throwing_output &operator++() noexcept
+    {
+        return *this;
+    }
+
+    throwing_output operator++(int) noexcept
+    {
+        return *this;
+    }
+
+private:
+    std::vector<T> *_out;
+    std::size_t _limit;
+};